@@ -0,0 +1,69 @@
+#pragma once
+#include "chess/defs.hpp"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace chess {
+
+// Slider attack lookup (bishops, rooks, queens).
+// Every square owns a slice of a shared attack table. The slice is indexed either by
+// PEXT(occupied, mask) when the CPU has fast BMI2, or by the classic magic multiply
+// ((occupied & mask) * magic) >> shift otherwise. The choice is made once at startup.
+struct Magic {
+    U64  mask   = 0;       // relevant blockers (board edges excluded)
+    U64  magic  = 0;       // multiplier for the portable fallback
+    U64* attacks = nullptr; // this square's slice of the attack table
+    unsigned shift = 0;    // 64 - popcount(mask)
+
+    unsigned index(U64 occupied) const;
+};
+
+extern Magic BISHOP_MAGICS[64];
+extern Magic ROOK_MAGICS[64];
+
+// true when the tables were built for PEXT indexing
+extern bool USE_PEXT;
+
+// PEXT without requiring -mbmi2 for the whole build, only executed when USE_PEXT is set
+inline U64 pext(U64 src, U64 mask) {
+#if defined(__BMI2__)
+    return _pext_u64(src, mask);
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    U64 r;
+    asm("pextq %2, %1, %0" : "=r"(r) : "r"(src), "r"(mask));
+    return r;
+#else
+    (void)src; (void)mask;
+    return 0;
+#endif
+}
+
+inline unsigned Magic::index(U64 occupied) const {
+    if (USE_PEXT) return static_cast<unsigned>(pext(occupied, mask));
+    return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+}
+
+// attack set of a bishop on sq given the board occupancy (includes the first blocker)
+inline U64 bishopAttacks(int sq, U64 occupied) {
+    const Magic& m = BISHOP_MAGICS[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+// attack set of a rook on sq given the board occupancy (includes the first blocker)
+inline U64 rookAttacks(int sq, U64 occupied) {
+    const Magic& m = ROOK_MAGICS[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+inline U64 queenAttacks(int sq, U64 occupied) {
+    return bishopAttacks(sq, occupied) | rookAttacks(sq, occupied);
+}
+
+// LINE_BB[a][b]: the whole rank/file/diagonal through a and b, 0 if they are not aligned
+// BETWEEN_BB[a][b]: squares strictly between a and b, 0 if they are not aligned
+extern U64 LINE_BB[64][64];
+extern U64 BETWEEN_BB[64][64];
+
+} // namespace chess
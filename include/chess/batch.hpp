@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace chess {
+
+// What runBatch computes for every position
+enum BatchJob {
+    JOB_LEGAL,  // number of legal moves
+    JOB_PERFT,  // leaf count at depth
+    JOB_EVAL,   // static evaluation
+    JOB_SEARCH, // best move and score, to depth and/or nodes
+};
+
+struct BatchOptions {
+    BatchJob job = JOB_LEGAL;
+    int depth = 1;             // perft depth; search depth limit (0 = none)
+    std::uint64_t nodes = 0;   // search node limit (0 = none)
+    int threads = 1;
+    std::size_t hashMb = 1;    // per-thread search table, cleared before every position (keep it small)
+};
+
+struct BatchStats {
+    std::uint64_t positions = 0; // lines holding a position, valid or not
+    std::uint64_t invalid = 0;   // of which could not be parsed or are not legal positions
+    std::uint64_t nodes = 0;     // perft leaves or search nodes, summed
+    std::int64_t ms = 0;
+};
+
+// Run opts.job on every position of an EPD or FEN file, one per line (see setFromEPD;
+// blank lines and lines starting with '#' are skipped). The file is memory-mapped and
+// each line parsed in place; the positions are shared out in chunks over a thread pool.
+// Every position gives one line of out, in input order: the input line followed by the
+// result as EPD operations, moves in UCI notation:
+//   JOB_LEGAL   D1 <moves>;
+//   JOB_PERFT   D<depth> <leaves>;
+//   JOB_EVAL    ce <centipawns>;
+//   JOB_SEARCH  bm <move>; ce <centipawns>; acd <depth>; acn <nodes>;
+//   invalid     c0 "invalid position";
+// Scores are from the side to move's view. Results do not depend on opts.threads.
+// False (and error, if given) if the file cannot be read.
+bool runBatch(const std::string& path, const BatchOptions& opts, std::ostream& out,
+              BatchStats* stats = nullptr, std::string* error = nullptr);
+
+} // namespace chess
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+
+#include "chess/search.hpp"
+
+namespace chess {
+
+// Fixed-depth search of a fixed suite of positions, one thread, fresh table per position.
+// Prints nodes, time and speed per position and in total; returns the total node count,
+// which only changes when the search does (the usual check that a speed-up is one).
+std::uint64_t bench(int depth, const SearchOptions& opts, std::ostream& out);
+
+} // namespace chess
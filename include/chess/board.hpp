@@ -3,15 +3,52 @@
 #include <vector> 
 #include "defs.hpp"
 #include "move.hpp"
+#include "zobrist.hpp"
+#include "psqt.hpp"
+#include "nnue.hpp"
 
 namespace chess {
 
+// what a generator produces
+enum GenType : uint8_t {
+    GEN_ALL,      // every move
+    GEN_CAPTURES, // captures (en passant included) and promotions, for the quiescence search
+    GEN_QUIETS,   // everything GEN_CAPTURES leaves out (castling included)
+    GEN_EVASIONS, // every move, the side to move being in check (GEN_ALL picks it then)
+};
+
+// Undo record for one ply. makeMove fills it with everything the move overwrites
+// that cannot be recomputed from the Move itself; unmakeMove restores from it.
+// Records are owned by the caller (typically one per recursion frame) and linked
+// through prev, so the chain is the game/search history.
+struct StateInfo {
+    U64 epTarget;
+    int halfmoveClock;
+    uint8_t castling;
+    Piece captured;   // piece removed by the move, PIECE_N if none
+    U64 key;          // Zobrist key before the move
+    int historyPlies; // Board::historyPlies before the move
+    StateInfo* prev;  // record of the previous ply, nullptr at the root
+    // NNUE, only while the board maintains an accumulator: the pieces the move changed, and
+    // the accumulator after the move once computed (see nnueAccumulator)
+    NnueDirty dirty;
+    bool accComputed[COLOR_N];
+    alignas(32) std::int16_t acc[COLOR_N][NNUE_L1];
+};
+
 struct Board {
     // bitboards: bb[color][piece]
     std::array<std::array<U64, PIECE_N>, COLOR_N> bb{};
 
     U64 occ[COLOR_N] = {0, 0}; // occupancy for each color
     U64 occAll = 0; // occAll = occ[WHITE] | occ[BLACK]
+
+    // piece type on each square (PIECE_N if empty), color comes from occ[]
+    std::array<Piece, 64> mailbox = []{
+        std::array<Piece, 64> m{};
+        m.fill(PIECE_N);
+        return m;
+    }();
     Color sideToMove {WHITE};
 
     uint8_t castling = CR_WK | CR_WQ | CR_BK | CR_BQ; // start: all rights available
@@ -19,6 +56,24 @@ struct Board {
     int  fullmoveNumber = 1;
     U64 epTarget = 0;
 
+    U64 key = 0; // Zobrist key of the position (see zobrist.hpp)
+
+    // evaluation accumulators (see psqt.hpp), kept up to date like the key
+    int psqMg = 0;  // material + piece-square, middlegame, white's point of view
+    int psqEg = 0;  // same for the endgame
+    int phase = 0;  // sum of PHASE_WEIGHT of the pieces on the board
+
+    // NNUE accumulator per perspective, valid for accNet (nullptr: not maintained, see nnue.hpp),
+    // of the position at accRoot: the records pushed above it carry their own
+    alignas(32) std::int16_t acc[COLOR_N][NNUE_L1] = {};
+    const NnueNetwork* accNet = nullptr;
+    StateInfo* accRoot = nullptr;
+
+    StateInfo* st = nullptr; // top of the undo stack (see makeMove)
+    // records on that stack whose key can be compared with this position: a null move or
+    // applyMove cuts the chain. The key history is the key field of those records
+    int historyPlies = 0;
+
 
     inline bool hasEP() const { return epTarget; }
     inline bool hasWK() const { return (castling & CR_WK); }
@@ -26,19 +81,77 @@ struct Board {
     inline bool hasBK() const { return (castling & CR_BK); }
     inline bool hasBQ() const { return (castling & CR_BQ); }
 
-    // recompute occupancies
+    // recompute occupancies, mailbox, key and evaluation accumulators from the bitboards and state
+    // (the NNUE accumulator for the current NNUE_NET)
     void recompute();
 
+    // Zobrist key computed from scratch (the incremental one is in key)
+    U64 computeKey() const;
+
     void setStartPos();
 
+    // piece of color c on sq, PIECE_N if none (O(1) through the mailbox)
     Piece pieceOn(int sq, Color c) const;
     Piece pieceOn(Square sq, Color c) const;
+    // piece of either color on sq, PIECE_N if empty
+    Piece pieceOn(int sq) const { return mailbox[sq]; }
+
+    // make a move that can be taken back: st receives the undo record and must stay alive until unmakeMove
+    void makeMove(const Move& move, StateInfo& st);
+    // take back the last move made with makeMove (move must be that same move)
+    void unmakeMove(const Move& move);
 
+    // pass the turn (null-move pruning): only side, en passant square and clock change
+    void makeNullMove(StateInfo& st);
+    void unmakeNullMove();
+
+    // make a move permanently, no undo record is kept
     void applyMove(const Move& move);
 
     Board applied(const Move& move) const;
 
-    // void undoMove();
+    // key after move, without making it. Approximate (castling and en-passant changes are
+    // ignored): good enough to prefetch the hash entry of the child before makeMove
+    U64 keyAfter(const Move& move) const;
+
+    // incremental piece updates, keep bb, occupancies, mailbox, key and the evaluation
+    // accumulators in sync (XOR / add, no recompute)
+    void putPiece(Color c, Piece p, int sq) {
+        const U64 m = BB(sq);
+        bb[c][p] ^= m;
+        occ[c] ^= m;
+        occAll ^= m;
+        mailbox[sq] = p;
+        key ^= ZOBRIST.piece[c][p][sq];
+        psqMg += PSQT.mg[c][p][sq];
+        psqEg += PSQT.eg[c][p][sq];
+        phase += PHASE_WEIGHT[p];
+        if (accNet) nnuePut(*this, c, p, sq);
+    }
+    void removePiece(Color c, Piece p, int sq) {
+        const U64 m = BB(sq);
+        bb[c][p] ^= m;
+        occ[c] ^= m;
+        occAll ^= m;
+        mailbox[sq] = PIECE_N;
+        key ^= ZOBRIST.piece[c][p][sq];
+        psqMg -= PSQT.mg[c][p][sq];
+        psqEg -= PSQT.eg[c][p][sq];
+        phase -= PHASE_WEIGHT[p];
+        if (accNet) nnueRemove(*this, c, p, sq);
+    }
+    void movePiece(Color c, Piece p, int from, int to) {
+        const U64 m = BB(from) | BB(to);
+        bb[c][p] ^= m;
+        occ[c] ^= m;
+        occAll ^= m;
+        mailbox[from] = PIECE_N;
+        mailbox[to] = p;
+        key ^= ZOBRIST.piece[c][p][from] ^ ZOBRIST.piece[c][p][to];
+        psqMg += PSQT.mg[c][p][to] - PSQT.mg[c][p][from];
+        psqEg += PSQT.eg[c][p][to] - PSQT.eg[c][p][from];
+        if (accNet) nnueMove(*this, c, p, from, to);
+    }
     
     bool canCastleKingSide(Color c) const;
 
@@ -46,45 +159,72 @@ struct Board {
 
     bool isSquareAttacked(Square sq, Color by) const;
 
+    // all pieces of both colors attacking sq, sliders see through everything not in occupied
+    U64 attackersTo(Square sq, U64 occupied) const;
+    U64 attackersTo(Square sq) const { return attackersTo(sq, occAll); }
+
     bool isInCheck(Color c) const;
     bool isInCheck() const; // uses sideToMove
+    // one king each and the side that just moved not in check: what the generators and the
+    // search take for granted (a FEN can describe anything)
+    bool isPlayable() const;
 
     bool hasLegalMove() const;
     bool isCheckmate() const;
     bool isStalemate() const;
+    // checkmate, stalemate, fifty-move rule or threefold repetition, else PLAYING
     GameState state() const;
 
-    static void push_promos(std::vector<Move>& moves, int from, int to, U16 baseFlags);
-
-    // generate legal moves returns a vector of Move
+    // draws by rule. The history walk is bounded by halfmoveClock (no position before an
+    // irreversible move can come back), so it costs O(plies since the last one).
+    // fifty moves without capture or pawn move, unless the side to move is mated
+    bool isFiftyMoveDraw() const;
+    // the position occurred before: once is enough if that was less than ply plies ago
+    // (inside the search, ply plies from its root), otherwise twice (threefold)
+    bool isRepetition(int ply) const;
+    bool isDraw(int ply) const { return isFiftyMoveDraw() || isRepetition(ply); }
+    // some reversible move of the side to move reaches a position seen less than ply
+    // plies ago (cuckoo table of the reversible moves, see board.cpp): the draw is at hand
+    bool hasUpcomingRepetition(int ply) const;
+
+    static void push_promos(MoveList& moves, int from, int to, U16 baseFlags);
+    // one move per set bit of targets, flagged as capture when the target is in enemy
+    static void push_moves(MoveList& moves, int from, U64 targets, U64 enemy);
+
+    // generators append to a caller-owned MoveList (no heap allocation)
+    void generateMoves(MoveList& moves) const;      // pseudo-legal, may leave the king in check
+    // legal only, no make/test filtering; fromMask keeps the moves of the pieces on those squares
+    void generateLegalMoves(MoveList& moves, GenType type = GEN_ALL, U64 fromMask = ~0ULL) const;
+
+    // convenience adapters that return a vector of Move
     std::vector<Move> generateMoves() const;
     std::vector<Move> generateLegalMoves() const;
 
-    static void genPawnMoves  (std::vector<Move>&, U64, int, Color, const Board&);
-    static void genKnightMoves(std::vector<Move>&, U64, int, Color, const Board&);
-    static void genBishopMoves(std::vector<Move>&, U64, int, Color, const Board&);
-    static void genRookMoves  (std::vector<Move>&, U64, int, Color, const Board&);
-    static void genQueenMoves (std::vector<Move>&, U64, int, Color, const Board&);
-    static void genKingMoves  (std::vector<Move>&, U64, int, Color, const Board&);
-
-    static void genDiagonalMoves(std::vector<Move>&, U64, int, Color, const Board&, Piece piece);
-    static void genStraightMoves(std::vector<Move>&, U64, int, Color, const Board&, Piece piece);
-
-
+    // enemy pieces giving check to the side to move
+    U64 checkers() const;
+    // pieces of color c that are the only piece between their king and an enemy slider
+    U64 pinnedPieces(Color c) const;
+    // false if the en passant capture from -> to would expose c's king to a slider
+    bool epIsSafe(int from, int to, Color c) const;
+
+    // colour-templated bodies of the functions above: side-dependent shifts, ranks and
+    // castling squares are compile-time constants (definitions in board.cpp)
+    template <Color Us> void makeMove(const Move& move, StateInfo& st);
+    template <Color Us> void unmakeMove(const Move& move);
+    template <Color By> bool isSquareAttacked(Square sq) const;
+    template <Color Us, bool KingSide> bool canCastle() const;
+    template <Color Us> void generatePseudo(MoveList& moves) const;
+    // checkersBB: checkers() of the position, GEN_EVASIONS only when there are some
+    template <Color Us, GenType Type> void generateLegal(MoveList& moves, U64 fromMask, U64 checkersBB) const;
+
+    // per-piece generators: append the moves whose target square is in targets (~0ULL for
+    // pseudo-legal generation, the check mask for legal generation)
+    // pawns are generated set-wise: all of them are shifted at once, then the target bits
+    // are popped with a fixed offset back to the from square
+    template <Color Us> void genPawnMoves(MoveList& moves, U64 pawns, U64 targets) const;
+    // pinned pieces only move along the line through kingSq
+    template <Color Us, Piece P> void genPieceMoves(MoveList& moves, U64 pieces, U64 targets, U64 pinned, Square kingSq) const;
+    template <Color Us> void genCastling(MoveList& moves, int kingSq) const;
 };
 
-// array of pointers that exists outside of the class so it will not be re-created for each instance of Board
-
-using MoveGenFn = void (*)(std::vector<Move>&, U64, int, Color, const Board&);
-
-inline constexpr std::array<MoveGenFn, PIECE_N> pieceFunctionArray = {
-    &Board::genPawnMoves,
-    &Board::genKnightMoves,
-    &Board::genBishopMoves,
-    &Board::genRookMoves,
-    &Board::genQueenMoves,
-    &Board::genKingMoves
-};
-
-
 } // namespace chess
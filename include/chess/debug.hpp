@@ -11,4 +11,9 @@ void printBoard(const Board& b, std::ostream& os);
 void printBB(U64 bitboard); // prints to std::cout
 void printBoard(const Board& b); // prints to std::cout
 
+// Compare the incrementally maintained state (occupancies, mailbox, Zobrist key,
+// evaluation and NNUE accumulators)
+// against a full recompute. Prints what differs to os and returns false on mismatch.
+bool checkIncremental(const Board& b, std::ostream& os);
+
 } // namespace chess
\ No newline at end of file
@@ -11,7 +11,7 @@ namespace chess
     enum Color : uint8_t { WHITE = 0, BLACK = 1, COLOR_N = 2 };
     enum Piece : uint8_t { PAWN = 0, KNIGHT, BISHOP, ROOK, QUEEN, KING, PIECE_N = 6 };
 
-    enum GameState : uint8_t { PLAYING = 0, CHECKMATE = 1, STALEMATE = 2 };
+    enum GameState : uint8_t { PLAYING = 0, CHECKMATE = 1, STALEMATE = 2, FIFTY_MOVES = 3, REPETITION = 4 };
 
     // Returns the opposite color
     inline constexpr Color other(Color c) { return c == WHITE ? BLACK : WHITE; }
@@ -46,6 +46,8 @@ namespace chess
     inline constexpr U64 FILE_H = 0x8080808080808080ULL;
     inline constexpr U64 RANK_1 = 0x00000000000000FFULL;
     inline constexpr U64 RANK_2 = 0x000000000000FF00ULL;
+    inline constexpr U64 RANK_3 = 0x0000000000FF0000ULL;
+    inline constexpr U64 RANK_6 = 0x0000FF0000000000ULL;
     inline constexpr U64 RANK_7 = 0x00FF000000000000ULL;
     inline constexpr U64 RANK_8 = 0xFF00000000000000ULL;
 
@@ -101,5 +103,23 @@ namespace chess
         return t;
     }();
 
+    //helper function to generate pawn attack bitboards
+    constexpr U64 pawn_from(U64 from, Color c) {
+        if (c == WHITE) return ((from & ~FILE_H) << 9) | ((from & ~FILE_A) << 7);
+        return ((from & ~FILE_H) >> 7) | ((from & ~FILE_A) >> 9);
+    }
+
+    // Precomputed pawn capture targets for each color and square.
+    // Read in reverse, PAWN_ATTACK_TARGETS[c][sq] are the squares from which a pawn
+    // of the other color attacks sq.
+    inline constexpr std::array<std::array<U64, 64>, COLOR_N> PAWN_ATTACK_TARGETS = []{
+        std::array<std::array<U64, 64>, COLOR_N> t{};
+        for (int sq = 0; sq < 64; ++sq) {
+            t[WHITE][sq] = pawn_from(1ULL << sq, WHITE);
+            t[BLACK][sq] = pawn_from(1ULL << sq, BLACK);
+        }
+        return t;
+    }();
+
 
 } // namespace chess
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+#include "chess/defs.hpp"
+
+namespace chess {
+
+struct Board;
+
+// Nominal piece values in centipawns, indexed by Piece (the king has no material value).
+// Used for move ordering; the evaluation itself uses the tapered values of psqt.hpp.
+inline constexpr std::array<int, PIECE_N> PIECE_VALUE = { 100, 320, 330, 500, 900, 0 };
+
+// Static evaluation in centipawns from the side to move's point of view:
+// material + piece-square tables, blended between middlegame and endgame by phase.
+// O(1), it reads the accumulators Board keeps up to date on every move.
+// Boards set up while a network is loaded (nnue.hpp) are evaluated by the network instead.
+int evaluate(const Board& b);
+
+} // namespace chess
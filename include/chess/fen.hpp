@@ -1,4 +1,7 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -10,10 +13,56 @@ struct Board;  // fwd-decl
 inline constexpr std::string_view STARTPOS_FEN =
     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+// Why a FEN (or EPD line) was refused
+enum FenError : uint8_t {
+    FEN_OK = 0,
+    FEN_MISSING_FIELD,   // fewer than six fields (four for EPD)
+    FEN_BAD_PIECE,       // placement: a character other than PNBRQKpnbrqk, 1-8 and '/'
+    FEN_BAD_RANK,        // placement: a rank of more or fewer than 8 squares
+    FEN_BAD_RANK_COUNT,  // placement: more or fewer than 8 ranks
+    FEN_BAD_SIDE,        // side to move other than "w" or "b"
+    FEN_BAD_CASTLING,    // castling other than "-" or letters of "KQkq"
+    FEN_BAD_EP,          // en passant other than "-" or a square
+    FEN_BAD_HALFMOVE,    // halfmove clock not a number >= 0
+    FEN_BAD_FULLMOVE,    // fullmove number not a number >= 1
+};
 
+// What parseFEN made of a text: the error and the offset in the text where it was found
+// (the offending character, or the start of the offending field; the text size for a
+// missing field). True when the position was read.
+struct FenResult {
+    FenError error = FEN_OK;
+    std::size_t offset = 0;
+    explicit operator bool() const { return error == FEN_OK; }
+};
+
+// short description of an error ("bad castling field")
+const char* fenErrorText(FenError e);
+
+// Set b from a FEN string (six fields; anything after them is ignored). Parses in place,
+// never allocates or throws; on error b is left as it was.
+FenResult parseFEN(Board& b, std::string_view fen);
+
+// Set b from an EPD line: the four position fields, then the FEN clocks if the next two
+// fields are numbers (else 0 and 1), then the operations ("bm e4; id \"x\";"), which are
+// returned trimmed in operations, as a view into line. So a FEN is also an EPD line.
+FenResult parseEPD(Board& b, std::string_view line, std::string_view* operations = nullptr);
+
+// parseFEN / parseEPD, only saying whether they succeeded
 bool setFromFEN(Board& b, std::string_view fen);
+bool setFromEPD(Board& b, std::string_view line, std::string_view* operations = nullptr);
+
+// Longest FEN writeFEN writes: 8 full ranks and 7 '/', "w", "KQkq", a square, two int
+// clocks (sign included) and the 5 spaces between the fields
+inline constexpr std::size_t FEN_MAX_LENGTH = 71 + 1 + 4 + 2 + 2 * 11 + 5;
+
+// Write b as FEN into out, which must have room for FEN_MAX_LENGTH chars, and return
+// the length (no terminating 0 is written). Never allocates.
+std::size_t writeFEN(const Board& b, char* out);
+// The same into a buffer of any size: 0 (and out unspecified) if the FEN does not fit.
+std::size_t writeFEN(const Board& b, std::span<char> out);
 
 // convert a Board to FEN (always succeeds).
 std::string toFEN(const Board& b);
 
-} // namespace chess
\ No newline at end of file
+} // namespace chess
@@ -1,6 +1,10 @@
 #pragma once
+#include <array>
+#include <cassert>
 #include <cstdint>
 
+#include "chess/defs.hpp"
+
 namespace chess
 {
     using U16 = uint16_t;
@@ -18,16 +22,91 @@ namespace chess
     inline constexpr U16 MF_PromoMask = MF_PromoQ | MF_PromoR | MF_PromoB | MF_PromoN;
 
 
+    // Move in 16 bits: from (6) | to (6) << 6 | type (4) << 12. The type codes are
+    //   0 quiet, 1 double push, 2 castle king side, 3 castle queen side,
+    //   4 capture, 5 en passant, 8..11 promotion to N B R Q, 12..15 the same capturing
+    // so bit 2 is "capture" and bit 3 "promotion". flags() turns the type back into the
+    // MF_* set through a table. The moving piece is not stored: it is on from (mailbox).
+    // The all-zero move (a1a1) is "no move".
+    inline constexpr std::array<U16, 16> MOVE_TYPE_FLAGS = {
+        MF_None, MF_DoublePush, MF_CastleK, MF_CastleQ,
+        MF_Capture, MF_EnPassant | MF_Capture, MF_None, MF_None,
+        MF_PromoN, MF_PromoB, MF_PromoR, MF_PromoQ,
+        MF_Capture | MF_PromoN, MF_Capture | MF_PromoB, MF_Capture | MF_PromoR, MF_Capture | MF_PromoQ,
+    };
+
+    // type code of a (valid) MF_* set
+    inline constexpr U16 moveType(U16 flags) {
+        const U16 capture = (flags & MF_Capture) ? 4 : 0;
+        if (flags & MF_PromoMask) {
+            const U16 promo = (flags & MF_PromoN) ? 0 : (flags & MF_PromoB) ? 1 : (flags & MF_PromoR) ? 2 : 3;
+            return 8 | capture | promo;
+        }
+        if (flags & MF_EnPassant) return 5;
+        if (flags & MF_DoublePush) return 1;
+        if (flags & MF_CastleK) return 2;
+        if (flags & MF_CastleQ) return 3;
+        return capture;
+    }
+
     struct Move {
-        uint8_t from;
-        uint8_t to;
-        U16 flags;      // | of flags
-        Piece piece;   // piece moving
-        
-        // if we want undo functionality, we can add:
-        // Piece captured; // captured piece, or PIECE_N if none
+        U16 data; // left uninitialized by Move m; (as in MoveList), Move{} is "no move"
+        // the captured piece is kept in the StateInfo undo record (board.hpp), not in the move
+
+        Move() = default;
+        constexpr Move(int from, int to, U16 flags)
+            : data(static_cast<U16>(from | (to << 6) | (moveType(flags) << 12))) {}
+
+        constexpr int from()  const { return data & 63; }
+        constexpr int to()    const { return (data >> 6) & 63; }
+        constexpr U16 flags() const { return MOVE_TYPE_FLAGS[data >> 12]; }
+
+        // the 16 bits as they are, for the transposition table
+        constexpr U16 raw() const { return data; }
+        static constexpr Move fromRaw(U16 bits) {
+            Move m{};
+            m.data = bits;
+            return m;
+        }
+
+        bool operator==(const Move&) const = default;
     };
+    static_assert(sizeof(Move) == 2);
 
     inline constexpr bool has(U16 flags, U16 f) { return (flags & f) != 0; }
 
+    // piece a promotion turns into (flags must have one of MF_PromoMask)
+    inline constexpr Piece promoPiece(U16 flags) {
+        if (has(flags, MF_PromoQ)) return QUEEN;
+        if (has(flags, MF_PromoR)) return ROOK;
+        if (has(flags, MF_PromoB)) return BISHOP;
+        return KNIGHT;
+    }
+
+    // Fixed-capacity move buffer that lives on the stack, so generating moves never touches the heap.
+    // 256 is above the maximum number of legal moves in any reachable position (218).
+    struct MoveList {
+        static constexpr int CAPACITY = 256;
+
+        std::array<Move, CAPACITY> moves; // left uninitialized on purpose, only [0, count) is valid
+        int count = 0;
+
+        void push_back(const Move& m) {
+            assert(count < CAPACITY);
+            moves[count++] = m;
+        }
+        void clear() { count = 0; }
+
+        int  size()  const { return count; }
+        bool empty() const { return count == 0; }
+
+        Move&       operator[](int i)       { return moves[i]; }
+        const Move& operator[](int i) const { return moves[i]; }
+
+        Move*       begin()       { return moves.data(); }
+        Move*       end()         { return moves.data() + count; }
+        const Move* begin() const { return moves.data(); }
+        const Move* end()   const { return moves.data() + count; }
+    };
+
 } // namespace chess
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+
+#include "chess/board.hpp"
+#include "chess/defs.hpp"
+#include "chess/move.hpp"
+
+namespace chess {
+
+// quiet cutoffs by side, from, to ("butterfly" board)
+using ButterflyHistory = int[COLOR_N][64][64];
+// quiet cutoffs by the previous move (piece, to) and this one (piece, to)
+using ContinuationHistory = int[PIECE_N][64][PIECE_N][64];
+// quiet move that refuted the previous move (piece, to)
+using CounterMoves = Move[PIECE_N][64];
+
+// history scores stay within +-HISTORY_MAX (see updateHistory)
+inline constexpr int HISTORY_MAX = 8192;
+
+// move a bonus (or a malus, if negative) into a history entry; the step shrinks as the
+// entry nears HISTORY_MAX, so it never overflows
+inline void updateHistory(int& h, int bonus) {
+    h += bonus - h * (bonus < 0 ? -bonus : bonus) / HISTORY_MAX;
+}
+
+// Hands out the legal moves of a position one at a time, best guess first, generating
+// them in stages so a node that cuts off early never generates the rest:
+//
+//   1. the hash move (checked to be legal first)
+//   2. captures and promotions with a non-negative SEE, by MVV-LVA
+//   3. quiet moves: the two killers, the counter move, then butterfly + continuation history
+//   4. captures that lose material (SEE < 0)
+//
+// The quiescence form only has stage 2 with every capture, and stage 3 when in check.
+class MovePicker {
+public:
+    // main search. killers: this ply's two killers; counter: the counter move of the
+    // previous move (or none); contHist: continuation history row of the previous move,
+    // nullptr at the root
+    MovePicker(const Board& b, U16 ttMove, const Move* killers, const Move& counter,
+               const int (*history)[64], const int (*contHist)[64]);
+    // quiescence search: captures and promotions, every evasion when in check
+    MovePicker(const Board& b, bool inCheck);
+
+    // next move, false once every move has been handed out
+    bool next(Move& m);
+    // leave out the quiet moves not handed out yet (late-move pruning)
+    void skipQuiets() { skipQuietMoves = true; }
+
+private:
+    enum Stage : uint8_t {
+        TT_MOVE, CAPTURES_INIT, GOOD_CAPTURES, QUIETS_INIT, QUIETS, BAD_CAPTURES,
+        QS_CAPTURES_INIT, QS_CAPTURES, QS_EVASIONS_INIT, QS_EVASIONS, DONE
+    };
+
+    void scoreCaptures();
+    void scoreQuiets();
+    // swap the best-scored move of [cur, end) into cur
+    void selectBest();
+
+    const Board& b;
+    Stage stage;
+    Move ttMove{};
+    bool hasTTMove = false;
+    bool inCheck = false;
+    bool skipQuietMoves = false;
+    const Move* killers = nullptr;
+    Move counter{};
+    const int (*history)[64] = nullptr;
+    const int (*contHist)[64] = nullptr;
+
+    MoveList moves;
+    int scores[MoveList::CAPACITY];
+    int cur = 0;      // next move to look at
+    int end = 0;      // end of the moves of this stage
+    int badEnd = 0;   // losing captures are parked in [0, badEnd)
+};
+
+} // namespace chess
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "chess/defs.hpp"
+
+namespace chess {
+
+struct Board;
+
+// Efficiently updatable neural network evaluation (NNUE style).
+//
+// Input layer (HalfKA, king-bucketed): for each perspective, one feature per
+// (bucket of that side's king, piece colour relative to the perspective, piece type,
+// square seen from the perspective). Its output, the accumulator, is a sum of weight
+// columns: the accumulator after a move is the one before plus and minus the columns of
+// the pieces it moved. makeMove only records those pieces, the columns are applied when
+// the position is evaluated, and a king changing bucket rebuilds its side's perspective.
+//
+//   accumulator  2 x NNUE_L1  int16 (side to move first)
+//   -> clamp 0..127 -> 2*NNUE_L1 uint8 -> NNUE_L2 (int8 weights) -> clamp
+//   -> NNUE_L3 (int8 weights) -> clamp -> 1 output, centipawns = output / NNUE_OUTPUT_SCALE
+inline constexpr int NNUE_KING_BUCKETS = 4;
+inline constexpr int NNUE_INPUTS = NNUE_KING_BUCKETS * 2 * PIECE_N * 64;
+inline constexpr int NNUE_L1 = 64;
+inline constexpr int NNUE_L2 = 16;
+inline constexpr int NNUE_L3 = 32;
+inline constexpr int NNUE_HIDDEN_SHIFT = 6;     // hidden layer outputs are (sum >> 6) clamped to 0..127
+inline constexpr int NNUE_OUTPUT_SCALE = 16;
+
+// Weights file: this header followed by the arrays of NnueNetwork in declaration order,
+// little-endian, no padding. The version changes whenever the layout does.
+inline constexpr char NNUE_MAGIC[4] = { 'C', 'N', 'U', 'E' };
+inline constexpr std::uint32_t NNUE_VERSION = 1;
+
+struct NnueFileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t inputs, l1, l2, l3; // must match the compiled sizes
+    std::uint32_t reserved[2];
+};
+static_assert(sizeof(NnueFileHeader) == 32, "weights must start 32-byte aligned");
+
+// Views into the memory-mapped weights file (never copied)
+struct NnueNetwork {
+    const std::int16_t* ftWeights; // [NNUE_INPUTS][NNUE_L1]
+    const std::int16_t* ftBias;    // [NNUE_L1]
+    const std::int8_t*  l1Weights; // [NNUE_L2][2 * NNUE_L1], one row per output
+    const std::int32_t* l1Bias;    // [NNUE_L2]
+    const std::int8_t*  l2Weights; // [NNUE_L3][NNUE_L2]
+    const std::int32_t* l2Bias;    // [NNUE_L3]
+    const std::int8_t*  outWeights;// [NNUE_L3]
+    const std::int32_t* outBias;   // [1]
+};
+
+// bytes of a valid weights file
+inline constexpr std::size_t NNUE_FILE_SIZE = sizeof(NnueFileHeader)
+    + sizeof(std::int16_t) * (NNUE_INPUTS * NNUE_L1 + NNUE_L1)
+    + sizeof(std::int8_t) * (NNUE_L2 * 2 * NNUE_L1) + sizeof(std::int32_t) * NNUE_L2
+    + sizeof(std::int8_t) * (NNUE_L3 * NNUE_L2) + sizeof(std::int32_t) * NNUE_L3
+    + sizeof(std::int8_t) * NNUE_L3 + sizeof(std::int32_t);
+
+// Network that boards pick up when their state is recomputed (setFromFEN, setStartPos,
+// recompute), nullptr = classical evaluation. Loaded networks stay mapped until exit,
+// so a board never points at unmapped weights.
+extern const NnueNetwork* NNUE_NET;
+
+// Map and validate a weights file and make it NNUE_NET. On failure NNUE_NET is kept,
+// false is returned and error (if given) says why. At startup the file named by the
+// CHESS_NNUE environment variable, if any, is loaded.
+bool nnueLoad(const std::string& path, std::string* error = nullptr);
+
+// SIMD kernels of the network, one set per instruction set
+struct NnueKernels {
+    const char* name;
+    // out = in + the added columns - the removed ones (NNUE_L1 each), in one pass; out may be in
+    void (*update)(std::int16_t* out, const std::int16_t* in, const std::int16_t* const* added, int nAdded,
+                   const std::int16_t* const* removed, int nRemoved);
+    void (*clampPack)(const std::int16_t* acc, std::uint8_t* out); // clamp NNUE_L1 values to 0..127
+    // out[j] = bias[j] + sum_i in[i] * weights[j * n + i], n a multiple of 16
+    void (*affine)(const std::uint8_t* in, int n, const std::int8_t* weights,
+                   const std::int32_t* bias, std::int32_t* out, int outputs);
+    // out[i] = (in[i] >> NNUE_HIDDEN_SHIFT) clamped to 0..127, n a multiple of 16
+    void (*clampHidden)(const std::int32_t* in, std::uint8_t* out, int n);
+};
+
+// Kernels in use: the best the CPU supports (avx-vnni, avx2, sse4.1, scalar), chosen at
+// startup. CHESS_SIMD=scalar|sse41|avx2|avxvnni selects a set (only ones the CPU supports;
+// an unsupported one falls back to the next lower).
+extern const NnueKernels* NNUE_KERNELS;
+// kernel set by name, nullptr if unknown or not supported by this CPU
+const NnueKernels* nnueKernels(const std::string& name);
+
+// Pieces one move took off and put on the board, a moving piece counting as both (a pawn
+// promoting on its arrival square only as the new piece). A king changing bucket sets
+// refresh for its side: that perspective is rebuilt instead of updated.
+struct NnueDirty {
+    struct Feature { Color c; Piece p; int sq; };
+    Feature added[2], removed[2];
+    int nAdded = 0, nRemoved = 0;
+    bool refresh[COLOR_N] = {};
+};
+
+// accumulator maintenance, called by Board: nnueRefresh rebuilds the board's own accumulator
+// (Board::acc), the others record the pieces of the move being made in b.st->dirty
+// (see putPiece/removePiece/movePiece)
+void nnueRefresh(Board& b, Color perspective);
+void nnuePut(Board& b, Color c, Piece p, int sq);
+void nnueRemove(Board& b, Color c, Piece p, int sq);
+void nnueMove(Board& b, Color c, Piece p, int from, int to);
+
+// accumulator of b's position for perspective (b.accNet must be set). Records on b's undo
+// stack above b.accRoot get theirs computed here, from the nearest computed one below.
+const std::int16_t* nnueAccumulator(const Board& b, Color perspective);
+
+// network output for b (b.accNet must be set), centipawns from the side to move's view
+int nnueEvaluate(const Board& b);
+
+} // namespace chess
@@ -1,6 +1,10 @@
 #pragma once
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 
 #include "chess/defs.hpp"
 #include "chess/move.hpp"
@@ -8,6 +12,7 @@
 namespace chess {
 
 struct Board;
+class ThreadPool;
 
 // Perft stats
 struct PerftStats {
@@ -20,13 +25,60 @@ struct PerftStats {
     std::uint64_t checkmates  = 0;
 };
 
-// Count stats at an exact depth (depth >= 1).
+// Transposition cache for perft: a power-of-two number of one-cache-line entries, each
+// holding the full PerftStats of one (Zobrist key, depth). Reads and writes take no lock:
+// an entry stores key ^ depth ^ (xor of its counters), so an entry torn by a concurrent
+// writer fails the check on probe and is treated as a miss.
+class PerftHash {
+public:
+    explicit PerftHash(std::size_t mb); // uses the largest power of two entries fitting in mb
+    PerftHash(const PerftHash&) = delete;
+    PerftHash& operator=(const PerftHash&) = delete;
+
+    bool probe(U64 key, int depth, PerftStats& out) const;
+    void store(U64 key, int depth, const PerftStats& s);
+    void clear(); // drops all entries and resets the counters
+
+    std::size_t entries() const { return mask + 1; }
+
+    // filled in by perft_stats
+    std::atomic<std::uint64_t> probes{0};
+    std::atomic<std::uint64_t> hits{0};
+
+private:
+    struct alignas(64) Entry {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> counters[7]{};
+    };
+
+    std::unique_ptr<Entry[]> table;
+    std::size_t mask = 0;
+};
+
+// Count stats at an exact depth. Depth 0 (or less) is the root alone: nodes = 1, no
+// features, the same as perft_nodes.
 // Convention: stats are counted on the lastply
 //   depth=1: counts features of the root legal moves.
 //   depth=2: counts features of moves one ply deeper, etc.
-PerftStats perft_stats(const Board& b, int depth);
+// With a hash, subtrees already counted (same key and depth) are taken from the cache.
+PerftStats perft_stats(const Board& b, int depth, PerftHash* hash = nullptr);
+
+// Same counts as perft_stats, computed on a thread pool. The tree is split at the root,
+// or a few plies deeper when the root has too few moves to keep every worker busy;
+// each subtree is a task and results are summed per worker, so the totals are identical
+// to the single-threaded run. The hash (if any) is shared by all workers.
+PerftStats perft_stats_parallel(const Board& b, int depth, ThreadPool& pool, PerftHash* hash = nullptr);
+
+// Leaf node count only (bulk counting): at the last ply the legal moves are counted,
+// not made, so no leaf features are available. Much faster than perft_stats.
+std::uint64_t perft_nodes(const Board& b, int depth, PerftHash* hash = nullptr);
+std::uint64_t perft_nodes_parallel(const Board& b, int depth, ThreadPool& pool, PerftHash* hash = nullptr);
 
 // text for a move like "e2e4", "e7e8q"
 std::string toUci(const Move& m);
 
+// the legal move of b written like toUci writes it (castling is the king's move, "e1g1"),
+// false if text is not one
+bool fromUci(const Board& b, std::string_view text, Move& out);
+
 } // namespace chess
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "chess/board.hpp"
+#include "chess/defs.hpp"
+#include "chess/move.hpp"
+#include "chess/tt.hpp"
+
+namespace chess {
+
+inline constexpr int MAX_PLY = 128;
+
+// Scores are centipawns from the side to move's point of view.
+// A mate found at ply p scores VALUE_MATE - p (or the negative when being mated).
+inline constexpr int VALUE_INF  = 32001;
+inline constexpr int VALUE_MATE = 32000;
+inline constexpr int VALUE_MATE_IN_MAX_PLY = VALUE_MATE - MAX_PLY;
+
+// What the caller allows the search to spend. Zero means "no limit" for every field.
+struct SearchLimits {
+    int depth = 0;               // iterations to run, in plies
+    std::uint64_t nodes = 0;     // stop after about this many nodes
+    std::int64_t movetime = 0;   // ms for this move, exactly
+    std::int64_t wtime = 0;      // ms left on the clocks
+    std::int64_t btime = 0;
+    std::int64_t winc = 0;       // ms increment per move
+    std::int64_t binc = 0;
+    int movestogo = 0;           // moves to the next time control, 0 = sudden death
+    bool infinite = false;       // search until stop()
+    bool ponder = false;         // the clock starts at ponderhit(), until then search on
+};
+
+// Selective search. Every technique can be switched off on its own, to measure what
+// it is worth (bench, A/B matches).
+struct SearchOptions {
+    bool nullMove = true;         // null-move pruning (not with fewer than two pieces left)
+    bool lmr = true;              // late-move reductions
+    bool reverseFutility = true;  // static eval far above beta at low depth: fail high
+    bool lateMovePruning = true;  // skip the late quiet moves at low depth
+    bool aspiration = true;       // narrow root window around the previous score
+    bool upcomingRepetition = true; // a move that repeats a position of the search: alpha >= draw
+};
+
+// Result of one completed iteration (the last one is the search result)
+struct SearchInfo {
+    int depth = 0;
+    int score = 0;
+    std::uint64_t nodes = 0;
+    std::int64_t ms = 0;
+    std::uint64_t nps = 0;
+    int hashfull = 0;            // transposition table use, permille
+    std::uint64_t cutoffs = 0;           // fail-highs, all threads
+    std::uint64_t firstMoveCutoffs = 0;  // of which on the first move searched (move ordering quality)
+    std::vector<Move> pv;        // pv[0] is the best move, empty if there is no legal move
+};
+
+// Turns SearchLimits into two deadlines:
+//   optimum: do not start another iteration after this
+//   maximum: abort the running iteration (hard wall-clock budget)
+class TimeManager {
+public:
+    void init(const SearchLimits& limits, Color us);
+
+    std::int64_t elapsed() const; // ms since init
+    bool softExpired() const { return optimum > 0 && elapsed() >= optimum; }
+    bool hardExpired() const { return maximum > 0 && elapsed() >= maximum; }
+
+    std::int64_t optimum = 0; // 0 = no deadline
+    std::int64_t maximum = 0;
+
+    // kept back from every budget for process/GUI latency
+    static constexpr std::int64_t MOVE_OVERHEAD = 10;
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+struct SearchThread; // per-thread state, see search.cpp
+
+// Negamax alpha-beta (principal variation search) with iterative deepening and
+// principal-variation tracking; the leaves run a quiescence search over captures and
+// promotions, and the tree is pruned and reduced as SearchOptions allow.
+// With setThreads(n > 1) the search is Lazy SMP: n threads search the same root on
+// their own board copies, sharing only the transposition table, and vote on the move.
+class Search {
+public:
+    using InfoFn = std::function<void(const SearchInfo&)>;
+
+    Search();
+    ~Search();
+    Search(const Search&) = delete;
+    Search& operator=(const Search&) = delete;
+
+    // Search root within limits, calling onIteration after every depth completed by the
+    // main thread. Returns the chosen iteration; pv[0] is the move to play.
+    SearchInfo go(const Board& root, const SearchLimits& limits, const InfoFn& onIteration = {});
+
+    // Ask a running go() to return as soon as possible (safe from another thread)
+    void stop() { stopFlag.store(true, std::memory_order_relaxed); }
+    // The move pondered on was played: a go() with limits.ponder now runs on its time
+    // limits, counted from here (safe from another thread)
+    void ponderhit() { pondering.store(false, std::memory_order_relaxed); }
+
+    // nodes of the last (or running) search, all threads
+    std::uint64_t nodes() const;
+
+    // number of search threads (at least 1), takes effect at the next go()
+    void setThreads(int n);
+    int threadCount() const { return static_cast<int>(threads.size()); }
+
+    // selective search switches, take effect at the next go()
+    void setOptions(const SearchOptions& o) { opts = o; }
+    const SearchOptions& options() const { return opts; }
+
+    // transposition table size in MiB (exact), kept between searches until cleared
+    void setHashSize(std::size_t mb) { tt.resize(mb); }
+    // empty it, and the threads' evaluation caches
+    void clearHash();
+    const TranspositionTable& hash() const { return tt; }
+
+private:
+    void iterate(SearchThread& t, int maxDepth, const InfoFn& onIteration);
+    int negamax(SearchThread& t, int depth, int ply, int alpha, int beta);
+    int quiesce(SearchThread& t, int ply, int alpha, int beta);
+    void checkLimits();
+    void startClockOnPonderhit();
+    void fillCounters(SearchInfo& info) const;
+    SearchInfo pickBest() const;
+
+    std::atomic<bool> stopFlag{false};
+    std::atomic<bool> pondering{false};
+    bool clockStopped = false; // pondering, the time manager is not armed yet
+    Color rootSide = WHITE;
+    std::chrono::steady_clock::time_point startTime; // of go(), for the reported time and speed
+    SearchLimits limits;
+    SearchOptions opts;
+    TimeManager tm;
+    TranspositionTable tt;    // the only state shared between threads
+    std::vector<std::unique_ptr<SearchThread>> threads; // [0] is the main thread
+};
+
+} // namespace chess
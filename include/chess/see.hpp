@@ -0,0 +1,21 @@
+#pragma once
+#include "chess/defs.hpp"
+#include "chess/move.hpp"
+
+namespace chess {
+
+struct Board;
+
+// Static exchange evaluation: the material the side to move wins (negative: loses) by
+// playing m and then letting both sides recapture on m.to(), least valuable piece first,
+// each side free to stop when going on would cost it. Pieces values are PIECE_VALUE
+// (eval.hpp). Sliders behind a capturer join in (x-rays); pins are ignored, and a king
+// only recaptures when the square is no longer defended.
+// Works on any pseudo-legal move of the side to move; a quiet move scores 0 or what it
+// loses when the piece is taken.
+int see(const Board& b, const Move& m);
+
+// see(b, m) >= threshold
+bool seeGE(const Board& b, const Move& m, int threshold);
+
+} // namespace chess
@@ -0,0 +1,54 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chess {
+
+// Fixed set of worker threads with one task deque per worker.
+// submit() deals tasks round-robin; a worker pops from the back of its own deque
+// and, when that is empty, steals from the front of the others.
+class ThreadPool {
+public:
+    // worker index (0 .. size()-1) is passed to the task, so it can use per-thread state
+    using Task = std::function<void(int worker)>;
+
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    void submit(Task task);
+
+    // block until every submitted task has finished
+    void wait();
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    bool tryPop(int self, Task& out);
+    void workerLoop(int id);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex m;                  // guards queued/stop for the sleep/wake protocol
+    std::condition_variable wake;  // a task was queued (or stop)
+    std::condition_variable idle;  // unfinished dropped to 0
+    std::size_t queued = 0;        // tasks sitting in some deque
+    std::size_t unfinished = 0;    // queued + running
+    std::size_t next = 0;          // round-robin target of submit()
+    bool stop = false;
+};
+
+} // namespace chess
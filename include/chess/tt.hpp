@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "chess/defs.hpp"
+#include "chess/move.hpp"
+
+namespace chess {
+
+__extension__ typedef unsigned __int128 U128;
+
+// What a stored score says about the true value of the position
+enum Bound : uint8_t {
+    BOUND_NONE  = 0,      // empty slot
+    BOUND_UPPER = 1,      // failed low: value <= score
+    BOUND_LOWER = 2,      // failed high: value >= score
+    BOUND_EXACT = 3
+};
+
+// Moves are stored as their 16 bits (see move.hpp), 0 is "no move"
+inline U16 packMove(const Move& m) {
+    return m.raw();
+}
+
+// One decoded slot. In the table it is a single 64-bit word:
+//   key18 | move << 18 | score << 34 | depth << 50 | bound << 57 | generation << 59
+// 18 key bits against 8 slots: a position not in the table still matches a stored one
+// of its cluster about once in 32768 probes
+struct TTEntry {
+    uint32_t key18 = 0;   // low 18 bits of the Zobrist key (the high bits pick the cluster)
+    U16 move = 0;         // packMove() of the best/refutation move, 0 if none
+    int16_t score = 0;
+    uint8_t depth = 0;    // 7 bits, deeper stores are kept at 127 (above MAX_PLY - 1 anyway)
+    Bound bound = BOUND_NONE;
+    uint8_t generation = 0; // search that wrote it, 5 bits
+};
+
+// Shared hash table of search results, keyed by Zobrist.
+// The table is an array of 64-byte clusters of 8 slots, one cache line each.
+// A slot is one 64-bit word read and written atomically (relaxed), so threads can
+// share the table without locks and never see a half-written entry.
+class TranspositionTable {
+public:
+    static constexpr int CLUSTER_SIZE = 8;
+    static constexpr int GENERATION_MASK = 31;
+    static constexpr int KEY_BITS = 18;
+    static constexpr int DEPTH_MAX = 127;
+
+    explicit TranspositionTable(std::size_t mb = 16) { resize(mb); }
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // reallocate to exactly mb MiB (at least 1) and clear
+    void resize(std::size_t mb);
+    // zero the table, split over threads
+    void clear(int threads = 1);
+
+    // start of a new search: entries of older searches age and get replaced first
+    void newSearch() { generation8 = (generation8 + 1) & GENERATION_MASK; }
+    uint8_t generation() const { return generation8; }
+
+    // entry for key, false if not stored
+    bool probe(U64 key, TTEntry& out) const;
+    void store(U64 key, int score, int depth, Bound bound, U16 move);
+
+    // start loading the cluster of key into cache (call before the key is probed)
+    void prefetch(U64 key) const {
+#if defined(__GNUC__)
+        __builtin_prefetch(clusterOf(key));
+#else
+        (void)key;
+#endif
+    }
+
+    // permille of slots written by the current search, sampled over the first 1000 clusters
+    int hashfull() const;
+
+    std::size_t bytes() const { return clusterCount * sizeof(Cluster); }
+    std::size_t clusters() const { return clusterCount; }
+
+private:
+    struct alignas(64) Cluster {
+        U64 slots[CLUSTER_SIZE];
+    };
+    static_assert(sizeof(Cluster) == 64, "a cluster must fill exactly one cache line");
+
+    // cluster count need not be a power of two: the high half of key * count is the index
+    Cluster* clusterOf(U64 key) const {
+        return &table[static_cast<std::size_t>((static_cast<U128>(key) * clusterCount) >> 64)];
+    }
+
+    Cluster* table = nullptr;
+    std::size_t clusterCount = 0;
+    std::size_t sizeMb = 0;
+    uint8_t generation8 = 0;
+};
+
+} // namespace chess
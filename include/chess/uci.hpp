@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "chess/board.hpp"
+#include "chess/search.hpp"
+
+namespace chess {
+
+// UCI front-end: one command per line in, the replies on out. The search runs on its own
+// thread, so stop, ponderhit and isready are answered while it thinks.
+//
+//   uci, isready, ucinewgame, setoption name <id> [value <x>],
+//   position startpos|fen <fen> [moves <m1> <m2> ...],
+//   go [depth|nodes|movetime|wtime|btime|winc|binc|movestogo <n>] [infinite] [ponder],
+//   stop, ponderhit, quit, and d (print the position)
+class Uci {
+public:
+    explicit Uci(std::ostream& out);
+    ~Uci(); // a running search is stopped
+    Uci(const Uci&) = delete;
+    Uci& operator=(const Uci&) = delete;
+
+    // run one command line, false once it was quit
+    bool command(std::string_view line);
+    // run the lines of in until quit or end of input
+    void loop(std::istream& in);
+    // wait until the running search (if any) has sent its bestmove
+    void wait();
+
+    const Board& position() const { return board; }
+
+private:
+    void setOption(const std::string& name, const std::string& value);
+    void setPosition(std::istringstream& args);
+    void go(std::istringstream& args);
+    // the search may send its bestmove (infinite and ponder searches wait for this)
+    void release();
+    void send(const std::string& line);
+
+    std::ostream& out;
+    std::mutex outMutex;           // the search thread writes too
+
+    Search search;
+    Board board;
+    std::deque<StateInfo> states;  // undo records of the moves after the position's FEN
+
+    std::thread searchThread;
+    std::mutex releaseMutex;
+    std::condition_variable released;
+    bool mayAnswer = true;         // guarded by releaseMutex
+};
+
+} // namespace chess
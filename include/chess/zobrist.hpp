@@ -0,0 +1,42 @@
+#pragma once
+#include "chess/defs.hpp"
+
+namespace chess {
+
+// Random keys for Zobrist hashing. A position key is the XOR of the keys of
+// every piece on its square, the side key if black is to move, the key of the
+// castling rights mask and the file key of the en passant target (if any).
+struct ZobristKeys {
+    U64 piece[COLOR_N][PIECE_N][64];
+    U64 side;
+    U64 castling[16]; // indexed by the CR_* mask
+    U64 epFile[8];
+};
+
+// splitmix64, used at compile time so the keys are fixed across builds and runs
+constexpr U64 splitmix64(U64& s) {
+    U64 z = (s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+inline constexpr ZobristKeys ZOBRIST = []{
+    ZobristKeys k{};
+    U64 s = 0x2545F4914F6CDD1DULL;
+    for (int c = 0; c < COLOR_N; ++c)
+        for (int p = 0; p < PIECE_N; ++p)
+            for (int sq = 0; sq < 64; ++sq)
+                k.piece[c][p][sq] = splitmix64(s);
+    k.side = splitmix64(s);
+    // castling keys are combined per right so that castling[a | b] == castling[a] ^ castling[b]
+    U64 right[4];
+    for (U64& r : right) r = splitmix64(s);
+    for (int mask = 0; mask < 16; ++mask)
+        for (int i = 0; i < 4; ++i)
+            if (mask & (1 << i)) k.castling[mask] ^= right[i];
+    for (U64& f : k.epFile) f = splitmix64(s);
+    return k;
+}();
+
+} // namespace chess
@@ -0,0 +1,158 @@
+#include "chess/attacks.hpp"
+#include "chess/defs.hpp"
+
+#include <bit>
+#include <cstdlib>
+
+namespace chess {
+
+Magic BISHOP_MAGICS[64];
+Magic ROOK_MAGICS[64];
+bool  USE_PEXT = false;
+U64   LINE_BB[64][64];
+U64   BETWEEN_BB[64][64];
+
+// sum over all squares of 2^popcount(mask)
+static U64 ROOK_TABLE[0x19000];
+static U64 BISHOP_TABLE[0x1480];
+
+namespace {
+
+struct Dir { int df, dr; };
+
+constexpr Dir ROOK_DIRS[4]   = { {0, 1}, {0, -1}, {1, 0}, {-1, 0} };
+constexpr Dir BISHOP_DIRS[4] = { {1, 1}, {-1, 1}, {1, -1}, {-1, -1} };
+
+// slow ray walk, only used to fill the tables
+U64 slidingAttack(const Dir (&dirs)[4], int sq, U64 occupied) {
+    U64 attack = 0;
+    for (const Dir& d : dirs) {
+        int f = sq % 8 + d.df;
+        int r = sq / 8 + d.dr;
+        while (0 <= f && f < 8 && 0 <= r && r < 8) {
+            U64 s = 1ULL << (r * 8 + f);
+            attack |= s;
+            if (occupied & s) break;
+            f += d.df;
+            r += d.dr;
+        }
+    }
+    return attack;
+}
+
+// xorshift64* generator, deterministic so magics are the same on every run
+struct PRNG {
+    U64 s;
+    explicit PRNG(U64 seed) : s(seed) {}
+    U64 rand() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 2685821657736338717ULL;
+    }
+    // few bits set, good magic candidates
+    U64 sparse() { return rand() & rand() & rand(); }
+};
+
+// software PEXT, used to check that the hardware instruction behaves before trusting it
+U64 pextSoft(U64 src, U64 mask) {
+    U64 r = 0;
+    for (U64 bit = 1; mask; bit <<= 1) {
+        if (src & mask & -mask) r |= bit;
+        mask &= mask - 1;
+    }
+    return r;
+}
+
+bool cpuHasPext() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    if (std::getenv("CHESS_NO_PEXT")) return false; // force the magic fallback
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("bmi2")) return false;
+    const U64 src = 0xF0E1D2C3B4A59687ULL, mask = 0x00FF00FF0F0F3C3CULL;
+    return pext(src, mask) == pextSoft(src, mask);
+#else
+    return false;
+#endif
+}
+
+void initSlider(Magic (&magics)[64], U64* table, const Dir (&dirs)[4]) {
+    // seeds per rank that find magics quickly (any seed works, some are just slower)
+    constexpr U64 SEEDS[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+
+    static U64 occupancy[4096], reference[4096];
+    static int epoch[4096];
+    static int cnt = 0; // shared by both calls so stale epochs never look current
+    int size = 0;
+
+    for (int sq = 0; sq < 64; ++sq) {
+        Magic& m = magics[sq];
+
+        // edges only matter when the slider stands on them
+        const U64 edges = ((RANK_1 | RANK_8) & ~(RANK_1 << (8 * (sq / 8)))) |
+                          ((FILE_A | FILE_H) & ~(FILE_A << (sq % 8)));
+
+        m.mask  = slidingAttack(dirs, sq, 0) & ~edges;
+        m.shift = 64 - std::popcount(m.mask);
+        m.attacks = (sq == 0) ? table : magics[sq - 1].attacks + size;
+
+        // enumerate every subset of the mask (Carry-Rippler) with its attack set
+        U64 b = 0;
+        size = 0;
+        do {
+            occupancy[size] = b;
+            reference[size] = slidingAttack(dirs, sq, b);
+            if (USE_PEXT) m.attacks[pext(b, m.mask)] = reference[size];
+            ++size;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+
+        if (USE_PEXT) continue;
+
+        // search a magic that maps every subset to a slot without destructive collisions
+        PRNG rng(SEEDS[sq / 8]);
+        for (int i = 0; i < size;) {
+            for (m.magic = 0; std::popcount((m.magic * m.mask) >> 56) < 6;)
+                m.magic = rng.sparse();
+
+            // epoch marks slots as written in this attempt, so the slice is not cleared each try
+            for (++cnt, i = 0; i < size; ++i) {
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < cnt) {
+                    epoch[idx] = cnt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// needs the slider tables
+void initLines() {
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            const U64 ab = (1ULL << a) | (1ULL << b);
+            if (a != b && (bishopAttacks(a, 0) & (1ULL << b))) {
+                LINE_BB[a][b]    = (bishopAttacks(a, 0) & bishopAttacks(b, 0)) | ab;
+                BETWEEN_BB[a][b] = bishopAttacks(a, ab) & bishopAttacks(b, ab);
+            } else if (a != b && (rookAttacks(a, 0) & (1ULL << b))) {
+                LINE_BB[a][b]    = (rookAttacks(a, 0) & rookAttacks(b, 0)) | ab;
+                BETWEEN_BB[a][b] = rookAttacks(a, ab) & rookAttacks(b, ab);
+            }
+        }
+    }
+}
+
+// fill the tables before main() runs
+struct AttackInit {
+    AttackInit() {
+        USE_PEXT = cpuHasPext();
+        initSlider(ROOK_MAGICS, ROOK_TABLE, ROOK_DIRS);
+        initSlider(BISHOP_MAGICS, BISHOP_TABLE, BISHOP_DIRS);
+        initLines();
+    }
+} attackInit;
+
+} // namespace
+
+} // namespace chess
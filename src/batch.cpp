@@ -0,0 +1,208 @@
+#include "chess/batch.hpp"
+#include "chess/board.hpp"
+#include "chess/eval.hpp"
+#include "chess/fen.hpp"
+#include "chess/perft.hpp"
+#include "chess/search.hpp"
+#include "chess/thread_pool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chess {
+
+// positions per chunk: the workers run one chunk while the previous one is written out
+static constexpr std::size_t CHUNK_POSITIONS = 4096;
+// positions per task, small enough for the workers to balance by stealing
+static constexpr std::size_t TASK_POSITIONS = 64;
+
+// read-only mapping of a whole file, unmapped when done
+struct BatchFile {
+    void* addr = MAP_FAILED;
+    std::size_t size = 0;
+    ~BatchFile() { if (addr != MAP_FAILED) munmap(addr, size); }
+
+    std::string_view text() const {
+        return addr == MAP_FAILED ? std::string_view{} : std::string_view(static_cast<const char*>(addr), size);
+    }
+};
+
+// one position: the line it came from and what the job made of it
+struct BatchEntry {
+    std::string_view line;
+    bool valid = false;
+    std::uint64_t count = 0; // legal moves, perft leaves or search nodes
+    int score = 0;
+    int depth = 0;
+    Move best{};
+};
+
+static bool fail(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+static bool mapFile(const std::string& path, BatchFile& file, std::string* error) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return fail(error, "cannot open " + path);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return fail(error, "cannot stat " + path);
+    }
+    file.size = static_cast<std::size_t>(st.st_size);
+    if (file.size > 0) file.addr = ::mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (file.size > 0 && file.addr == MAP_FAILED) return fail(error, path + ": mmap failed");
+    // read once, front to back
+    if (file.addr != MAP_FAILED) ::madvise(file.addr, file.size, MADV_SEQUENTIAL);
+    return true;
+}
+
+static void runJob(BatchEntry& e, const BatchOptions& opts, Search* search) {
+    Board b;
+    e.valid = setFromEPD(b, e.line) && b.isPlayable();
+    if (!e.valid) return;
+
+    switch (opts.job) {
+    case JOB_LEGAL: {
+        MoveList moves;
+        b.generateLegalMoves(moves);
+        e.count = moves.size();
+        break;
+    }
+    case JOB_PERFT:
+        e.count = perft_nodes(b, opts.depth);
+        break;
+    case JOB_EVAL:
+        e.score = evaluate(b);
+        break;
+    case JOB_SEARCH: {
+        SearchLimits limits;
+        limits.depth = opts.depth;
+        limits.nodes = opts.nodes;
+        // a fresh table: the result must not depend on what this thread searched before
+        search->clearHash();
+        const SearchInfo info = search->go(b, limits);
+        e.count = info.nodes;
+        e.score = info.score;
+        e.depth = info.depth;
+        e.best = info.pv.empty() ? Move{} : info.pv[0];
+        break;
+    }
+    }
+}
+
+// text and numbers into a line buffer, returning the new end
+static char* put(char* p, std::string_view text) {
+    return std::copy(text.begin(), text.end(), p);
+}
+
+static char* put(char* p, std::int64_t value) {
+    return std::to_chars(p, p + 24, value).ptr;
+}
+
+static void writeChunk(const std::vector<BatchEntry>& chunk, const BatchOptions& opts, std::ostream& out,
+                       BatchStats& stats) {
+    char buf[128];
+    for (const BatchEntry& e : chunk) {
+        out.write(e.line.data(), static_cast<std::streamsize>(e.line.size()));
+        char* p = buf;
+        ++stats.positions;
+        if (!e.valid) {
+            ++stats.invalid;
+            p = put(p, " c0 \"invalid position\";");
+        } else if (opts.job == JOB_LEGAL) {
+            p = put(put(put(p, " D1 "), static_cast<std::int64_t>(e.count)), ";");
+        } else if (opts.job == JOB_PERFT) {
+            p = put(put(p, " D"), opts.depth);
+            p = put(put(put(p, " "), static_cast<std::int64_t>(e.count)), ";");
+            stats.nodes += e.count;
+        } else if (opts.job == JOB_EVAL) {
+            p = put(put(put(p, " ce "), e.score), ";");
+        } else {
+            if (e.best != Move{}) p = put(put(put(p, " bm "), toUci(e.best)), ";");
+            p = put(put(put(p, " ce "), e.score), ";");
+            p = put(put(put(p, " acd "), e.depth), ";");
+            p = put(put(put(p, " acn "), static_cast<std::int64_t>(e.count)), ";");
+            stats.nodes += e.count;
+        }
+        *p++ = '\n';
+        out.write(buf, p - buf);
+    }
+}
+
+// Next position line of text, which is advanced past it; false at the end. Line breaks
+// and surrounding blanks are dropped, blank lines and '#' comments skipped.
+static bool nextLine(std::string_view& text, std::string_view& line) {
+    while (!text.empty()) {
+        const std::size_t nl = text.find('\n');
+        line = text.substr(0, nl);
+        text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+        while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) line.remove_prefix(1);
+        while (!line.empty() && (line.back() == ' ' || line.back() == '\t' || line.back() == '\r')) line.remove_suffix(1);
+        if (!line.empty() && line.front() != '#') return true;
+    }
+    return false;
+}
+
+bool runBatch(const std::string& path, const BatchOptions& opts, std::ostream& out,
+              BatchStats* stats, std::string* error) {
+    if (opts.job == JOB_PERFT && opts.depth < 1) return fail(error, "perft needs a depth of at least 1");
+    if (opts.job == JOB_SEARCH && opts.depth <= 0 && opts.nodes == 0)
+        return fail(error, "search needs a depth or a node limit");
+
+    BatchFile file;
+    if (!mapFile(path, file, error)) return false;
+    const auto start = std::chrono::steady_clock::now();
+
+    ThreadPool pool(opts.threads);
+    std::vector<std::unique_ptr<Search>> searches;
+    if (opts.job == JOB_SEARCH) {
+        for (int i = 0; i < pool.size(); ++i) {
+            searches.push_back(std::make_unique<Search>());
+            searches.back()->setHashSize(opts.hashMb);
+        }
+    }
+
+    // two chunks in turn: while the workers run one, the other is written out
+    std::vector<BatchEntry> chunks[2];
+    for (auto& c : chunks) c.reserve(CHUNK_POSITIONS);
+    BatchStats total;
+    std::string_view text = file.text();
+    for (int cur = 0;; cur ^= 1) {
+        std::vector<BatchEntry>& chunk = chunks[cur];
+        chunk.clear();
+        std::string_view line;
+        while (chunk.size() < CHUNK_POSITIONS && nextLine(text, line)) chunk.push_back(BatchEntry{line});
+
+        for (std::size_t first = 0; first < chunk.size(); first += TASK_POSITIONS) {
+            const std::size_t last = std::min(first + TASK_POSITIONS, chunk.size());
+            pool.submit([&chunk, &opts, &searches, first, last](int worker) {
+                Search* search = searches.empty() ? nullptr : searches[worker].get();
+                for (std::size_t i = first; i < last; ++i) runJob(chunk[i], opts, search);
+            });
+        }
+        writeChunk(chunks[cur ^ 1], opts, out, total);
+        chunks[cur ^ 1].clear();
+        pool.wait();
+        if (chunk.empty()) break;
+    }
+
+    total.ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (stats) *stats = total;
+    return true;
+}
+
+} // namespace chess
@@ -0,0 +1,54 @@
+#include "chess/bench.hpp"
+#include "chess/board.hpp"
+#include "chess/fen.hpp"
+#include "chess/perft.hpp"
+
+#include <chrono>
+#include <ostream>
+
+namespace chess {
+
+// openings, middlegames and endgames, quiet and tactical
+static const char* BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8",
+    "2r3k1/pp3ppp/4p3/3pP3/3P1P2/P1r5/1P4PP/2R2RK1 w - - 0 24",
+    "r1b2rk1/2q1b1pp/p2ppn2/1p6/3QP3/1BN1B3/PPP3PP/R4RK1 w - - 0 16",
+    "6k1/5p2/6p1/8/7p/8/6PP/6K1 b - - 0 1",
+    "8/8/1p1k4/5ppp/PPK1p3/6P1/5PP1/8 b - - 0 40",
+};
+
+std::uint64_t bench(int depth, const SearchOptions& opts, std::ostream& out) {
+    Search search;
+    search.setOptions(opts);
+    SearchLimits limits;
+    limits.depth = depth;
+
+    std::uint64_t total = 0;
+    const auto start = std::chrono::steady_clock::now();
+    int i = 0;
+    for (const char* fen : BENCH_FENS) {
+        Board b;
+        setFromFEN(b, fen);
+        search.clearHash();
+        const SearchInfo info = search.go(b, limits);
+        total += info.nodes;
+        out << "position " << ++i << "  nodes " << info.nodes << "  " << info.ms << " ms  nps " << info.nps
+            << "  best " << (info.pv.empty() ? "none" : toUci(info.pv[0])) << "\n";
+    }
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    out << "===========================\n"
+        << "depth " << depth << "\n"
+        << "nodes " << total << "\n"
+        << "time  " << ms << " ms\n"
+        << "nps   " << (ms > 0 ? total * 1000 / static_cast<std::uint64_t>(ms) : 0) << "\n";
+    return total;
+}
+
+} // namespace chess
@@ -1,18 +1,52 @@
 #include "chess/board.hpp"
+#include "chess/attacks.hpp"
 #include "chess/defs.hpp"
+#include "chess/zobrist.hpp"
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <cstring>
 
 namespace chess {
 
-// recompute occ/occAll from bb[color][piece]
+// recompute occ/occAll, the mailbox and the key from bb[color][piece]
 void Board::recompute() {
     occ[WHITE] = occ[BLACK] = 0ULL;
-    for (int p = 0; p < PIECE_N; ++p) {
-        occ[WHITE] |= bb[WHITE][p];
-        occ[BLACK] |= bb[BLACK][p];
+    mailbox.fill(PIECE_N);
+    psqMg = psqEg = phase = 0;
+    for (int c = 0; c < COLOR_N; ++c) {
+        for (int p = 0; p < PIECE_N; ++p) {
+            occ[c] |= bb[c][p];
+            for (U64 pieces = bb[c][p]; pieces; pieces &= pieces - 1) {
+                const int sq = getSquare(pieces);
+                mailbox[sq] = static_cast<Piece>(p);
+                psqMg += PSQT.mg[c][p][sq];
+                psqEg += PSQT.eg[c][p][sq];
+                phase += PHASE_WEIGHT[p];
+            }
+        }
     }
     occAll = occ[WHITE] | occ[BLACK];
+    key = computeKey();
+    accNet = NNUE_NET;
+    accRoot = st;
+    if (accNet) {
+        nnueRefresh(*this, WHITE);
+        nnueRefresh(*this, BLACK);
+    }
+}
+
+// key from scratch, makeMove keeps it up to date incrementally
+U64 Board::computeKey() const {
+    U64 k = 0;
+    for (int c = 0; c < COLOR_N; ++c)
+        for (int p = 0; p < PIECE_N; ++p)
+            for (U64 pieces = bb[c][p]; pieces; pieces &= pieces - 1)
+                k ^= ZOBRIST.piece[c][p][getSquare(pieces)];
+    if (sideToMove == BLACK) k ^= ZOBRIST.side;
+    k ^= ZOBRIST.castling[castling];
+    if (epTarget) k ^= ZOBRIST.epFile[getSquare(epTarget) % 8];
+    return k;
 }
 
 // load the standard chess starting position
@@ -39,6 +73,10 @@ void Board::setStartPos() {
     bb[BLACK][KING]   = 0x1000000000000000ULL;
 
     sideToMove = WHITE;
+    castling = CR_WK | CR_WQ | CR_BK | CR_BQ;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    epTarget = 0;
     recompute();
 }
 
@@ -86,105 +124,44 @@ void Board::setStartPos() {
 
 Piece Board::pieceOn(int sq, Color c) const {
     assert(0 <= sq && sq < 64);
-    U64 m = BB(sq);
-    for (int p = 0; p < PIECE_N; ++p)
-        if (bb[c][p] & m) return static_cast<Piece>(p);
-    return PIECE_N;
+    return (occ[c] & BB(sq)) ? mailbox[sq] : PIECE_N;
 }
 
 Piece Board::pieceOn(Square sq, Color c) const {
-    U64 m = BB(sq);
-    for (int p = 0; p < PIECE_N; ++p)
-        if (bb[c][p] & m) return static_cast<Piece>(p);
-    return PIECE_N;
+    return (occ[c] & BB(sq)) ? mailbox[sq] : PIECE_N;
 }
 
-bool Board::isSquareAttacked(Square sq, Color by) const {
-    U64 sqBB = BB(sq);
-
-    // pawns
-    U64 whitePawnAttacks = ((bb[WHITE][PAWN] & ~FILE_H) << 9) | ((bb[WHITE][PAWN] & ~FILE_A) << 7);
-    U64 blackPawnAttacks = ((bb[BLACK][PAWN] & ~FILE_H) >> 7) | ((bb[BLACK][PAWN] & ~FILE_A) >> 9);
+U64 Board::attackersTo(Square sq, U64 occupied) const {
+    // every attack pattern is symmetric (pawns mirrored by color), so "what does a piece
+    // on sq attack" intersected with the real pieces gives the pieces attacking sq
+    return (PAWN_ATTACK_TARGETS[BLACK][sq] & bb[WHITE][PAWN])
+         | (PAWN_ATTACK_TARGETS[WHITE][sq] & bb[BLACK][PAWN])
+         | (KNIGHT_ATTACK_TARGETS[sq] & (bb[WHITE][KNIGHT] | bb[BLACK][KNIGHT]))
+         | (KING_ATTACK_TARGETS[sq]   & (bb[WHITE][KING]   | bb[BLACK][KING]))
+         | (bishopAttacks(sq, occupied) & (bb[WHITE][BISHOP] | bb[BLACK][BISHOP] |
+                                           bb[WHITE][QUEEN]  | bb[BLACK][QUEEN]))
+         | (rookAttacks(sq, occupied)   & (bb[WHITE][ROOK]   | bb[BLACK][ROOK] |
+                                           bb[WHITE][QUEEN]  | bb[BLACK][QUEEN]));
+}
 
-    if (by == WHITE) {
-        if (sqBB & whitePawnAttacks) return true;
-    } else { // by == BLACK
-        if (sqBB & blackPawnAttacks) return true;
-    }
+bool Board::isSquareAttacked(Square sq, Color by) const {
+    return by == WHITE ? isSquareAttacked<WHITE>(sq) : isSquareAttacked<BLACK>(sq);
+}
 
-    // knights
-    // KNIGHT_ATTACK_TARGETS[sq] returns a bitboard of a knight's attack pattern from square sq, 
-    // so if a knight of the enemy is on one of those squares, because knights attack symmetrically,
-    // the square sq is attacked by that knight
-    if ( KNIGHT_ATTACK_TARGETS[sq] & bb[by][KNIGHT] ) return true; 
-    
-    // kings
-    // same for kings
-    if ( KING_ATTACK_TARGETS[sq] & bb[by][KING] ) return true;
+template <Color By>
+bool Board::isSquareAttacked(Square sq) const {
+    // cheapest tests first, sliders last
+    if (PAWN_ATTACK_TARGETS[other(By)][sq] & bb[By][PAWN]) return true;
+    if (KNIGHT_ATTACK_TARGETS[sq] & bb[By][KNIGHT]) return true;
+    if (KING_ATTACK_TARGETS[sq] & bb[By][KING]) return true;
 
     // bishops/queens (diagonal attackers)
-    U64 diagonalAttackers = bb[by][BISHOP] | bb[by][QUEEN];
-    // rooks/queens (straight attackers)
-    U64 straightAttackers = bb[by][ROOK] | bb[by][QUEEN];
+    U64 diagonalAttackers = bb[By][BISHOP] | bb[By][QUEEN];
+    if (diagonalAttackers && (bishopAttacks(sq, occAll) & diagonalAttackers)) return true;
 
-    
-    // north
-    U64 p = sqBB;
-    while(( p = ( (p & ~RANK_8) << 8 ) )) {
-        if (p & straightAttackers) return true;
-        if (p & occAll) break;
-    }
-
-    // north-east
-    p = sqBB;
-    while(( p = ( (p & ~FILE_H & ~RANK_8) << 9 ) )) { 
-        if (p & diagonalAttackers) return true;
-        if (p & occAll) break;
-    }
-
-    // east
-    p = sqBB;
-    while(( p = ( (p & ~FILE_H) << 1 ) )) {
-        if (p & straightAttackers) return true;
-        if (p & occAll) break;
-    }
-
-    // south-east
-    p = sqBB;
-    while(( p = ( (p & ~FILE_H & ~RANK_1) >> 7 ) )){ 
-        if (p & diagonalAttackers) return true;
-        if (p & occAll) break;
-    } 
-    
-    // south
-    p = sqBB;
-    while(( p = ( (p & ~RANK_1) >> 8 ) )) {
-        if (p & straightAttackers) return true;
-        if (p & occAll) break;
-    }
-
-    // south-west
-    p = sqBB;
-    while(( p = ( (p & ~FILE_A & ~RANK_1) >> 9 ) )) { 
-        if (p & diagonalAttackers) return true;
-        if (p & occAll) break;
-    }
-
-    // west
-    p = sqBB;
-    while(( p = ( (p & ~FILE_A) >> 1 ) )) {
-        if (p & straightAttackers) return true;
-        if (p & occAll) break;
-    }
-
-    // north-west
-    p = sqBB;
-    while(( p = ( (p & ~FILE_A & ~RANK_8) << 7 ) )) { 
-        if (p & diagonalAttackers) return true;
-        if (p & occAll) break;
-    }
-
-    return false; // no attackers found
+    // rooks/queens (straight attackers)
+    U64 straightAttackers = bb[By][ROOK] | bb[By][QUEEN];
+    return straightAttackers && (rookAttacks(sq, occAll) & straightAttackers);
 }
 
 bool Board::isInCheck(Color c) const {
@@ -203,157 +180,242 @@ bool Board::isInCheck() const {
     return isSquareAttacked(kingSq, other(sideToMove));
 }
 
+bool Board::isPlayable() const {
+    if (std::popcount(bb[WHITE][KING]) != 1 || std::popcount(bb[BLACK][KING]) != 1) return false;
+    return !isInCheck(other(sideToMove));
+}
 
-void Board::applyMove(const Move& move) {
-    const Color us = sideToMove;
-    const Color them = other(us);
 
-    U64 fromBB = BB(move.from);
-    U64 toBB = BB(move.to);
+// castling rights that survive a move touching this square (as from or to square):
+// moving the king or a rook, or capturing a rook on its home square, drops the matching rights
+static constexpr std::array<uint8_t, 64> CASTLING_KEEP = []{
+    std::array<uint8_t, 64> t{};
+    for (auto& m : t) m = CR_WK | CR_WQ | CR_BK | CR_BQ;
+    t[E1] &= ~(CR_WK | CR_WQ);
+    t[H1] &= ~CR_WK;
+    t[A1] &= ~CR_WQ;
+    t[E8] &= ~(CR_BK | CR_BQ);
+    t[H8] &= ~CR_BK;
+    t[A8] &= ~CR_BQ;
+    return t;
+}();
+
+// shift a whole bitboard by D squares, up the board for D > 0
+template <int D>
+constexpr U64 shift(U64 b) {
+    return D > 0 ? b << D : b >> -D;
+}
 
-    assert((bb[us][move.piece] & fromBB) != 0); // piece must be on "from" square
+// compile-time squares and masks of one side, for the colour templates below
+template <Color Us>
+struct SideSquares {
+    static constexpr int Up = Us == WHITE ? 8 : -8;          // pawn push
+    static constexpr int UpWest = Up - 1, UpEast = Up + 1;   // pawn captures towards the a and h files
+    static constexpr U64 DoublePushRank = Us == WHITE ? RANK_3 : RANK_6; // a single push landing here may go on
+    static constexpr U64 PromoRank = Us == WHITE ? RANK_8 : RANK_1;
+    static constexpr Square King = Us == WHITE ? E1 : E8;
+    static constexpr Square KingKTo = Us == WHITE ? G1 : G8, KingQTo = Us == WHITE ? C1 : C8;
+    static constexpr Square RookK = Us == WHITE ? H1 : H8, RookKTo = Us == WHITE ? F1 : F8;
+    static constexpr Square RookQ = Us == WHITE ? A1 : A8, RookQTo = Us == WHITE ? D1 : D8;
+    static constexpr uint8_t CastleK = Us == WHITE ? CR_WK : CR_BK;
+    static constexpr uint8_t CastleQ = Us == WHITE ? CR_WQ : CR_BQ;
+    // squares between king and rook, they must be empty
+    static constexpr U64 PathK = BB(RookKTo) | BB(KingKTo);
+    static constexpr U64 PathQ = BB(RookQTo) | BB(KingQTo) | BB(static_cast<Square>(KingQTo - 1));
+};
+
+void Board::makeMove(const Move& move, StateInfo& newSt) {
+    if (sideToMove == WHITE) makeMove<WHITE>(move, newSt);
+    else                     makeMove<BLACK>(move, newSt);
+}
 
-    // remove piece from "from" square
-    bb[us][move.piece] &= ~fromBB;
+template <Color Us>
+void Board::makeMove(const Move& move, StateInfo& newSt) {
+    using S = SideSquares<Us>;
+    constexpr Color Them = other(Us);
+    const int from = move.from();
+    const int to = move.to();
+    const U16 flags = move.flags();
+    const Piece piece = mailbox[from];
+
+    assert(sideToMove == Us && piece != PIECE_N && (occ[Us] & BB(from))); // our piece must be on "from" square
+
+    // save what cannot be recovered from the move, and push it on the stack
+    newSt.castling = castling;
+    newSt.epTarget = epTarget;
+    newSt.halfmoveClock = halfmoveClock;
+    newSt.captured = PIECE_N;
+    newSt.key = key;
+    newSt.historyPlies = historyPlies;
+    if (accNet) {
+        newSt.dirty = NnueDirty{};
+        newSt.accComputed[WHITE] = newSt.accComputed[BLACK] = false;
+    }
+    newSt.prev = st;
+    st = &newSt;
+    ++historyPlies;
+
+    // handle captures (before moving, the captured piece may sit on "to")
+    if (has(flags, MF_EnPassant)) {
+        // the captured pawn is behind the target square
+        removePiece(Them, PAWN, to - S::Up);
+        newSt.captured = PAWN;
+    } else if (has(flags, MF_Capture)) {
+        Piece captured = mailbox[to]; // find captured piece
+        assert(captured != PIECE_N && (occ[Them] & BB(to))); // there must be a piece to capture
+        removePiece(Them, captured, to);
+        newSt.captured = captured;
+    }
+
+    movePiece(Us, piece, from, to);
+
+    // handle promotions: swap the pawn that arrived for the new piece
+    if (has(flags, MF_PromoMask)) {
+        removePiece(Us, PAWN, to);
+        putPiece(Us, promoPiece(flags), to);
+    }
+
+    // handle castling: the king already moved, bring the rook over
+    assert(!(has(flags, MF_CastleK) && has(flags, MF_CastleQ))); // can't castle both sides at once
+    if (has(flags, MF_CastleK)) {
+        movePiece(Us, ROOK, S::RookK, S::RookKTo);
+    } else if (has(flags, MF_CastleQ)) {
+        movePiece(Us, ROOK, S::RookQ, S::RookQTo);
+    }
+
+    // set en passant target square behind a double pushed pawn, clear it otherwise
+    if (epTarget) key ^= ZOBRIST.epFile[getSquare(epTarget) % 8];
+    if (has(flags, MF_DoublePush)) {
+        epTarget = BB(to - S::Up);
+    } else {
+        epTarget = 0;
+    }
+    if (epTarget) key ^= ZOBRIST.epFile[getSquare(epTarget) % 8];
 
-    // place piece on "to" square
-    bb[us][move.piece] |= toBB; 
+    // update castling rights
+    key ^= ZOBRIST.castling[castling];
+    castling &= CASTLING_KEEP[from] & CASTLING_KEEP[to];
+    key ^= ZOBRIST.castling[castling];
 
-    if (has(move.flags, MF_DoublePush)) {
-        // set en passant target square
-        if (us == WHITE) {
-            epTarget = BB(move.to - 8); // square behind the pawn
-        } else {
-            epTarget = BB(move.to + 8); // square behind the pawn
-        }
+    if (piece == PAWN || has(flags, MF_Capture)) {
+        halfmoveClock = 0;
     } else {
-        epTarget = 0; // clear en passant target if not a double push
-    }
-
-    // handle captures
-    if (has(move.flags, MF_Capture)) {
-        // en passant capture
-        if (has(move.flags, MF_EnPassant)) {
-            if (us == WHITE) {
-                U64 capturedPawnBB = BB(move.to - 8); // square of the captured pawn
-                bb[BLACK][PAWN] &= ~capturedPawnBB; // remove captured pawn
-            } else {
-                U64 capturedPawnBB = BB(move.to + 8); // square of the captured pawn
-                bb[WHITE][PAWN] &= ~capturedPawnBB; // remove captured pawn
-            }
-        } else { // regular capture
-            Piece captured = pieceOn(move.to, them); // find captured piece
-            assert(captured != PIECE_N); // there must be a piece to capture
-            bb[them][captured] &= ~toBB; // remove captured piece
-
-
-            // update castling rights if rook is captured
-            // I think I will do a simple check if rook is on its home square when trying to castle
-            // and handle it there
-
-            // if (captured == ROOK) {
-            //     if (them == WHITE) {
-            //         if (toBB & BB(H1)) {
-            //             castling &= ~CR_WK; // white king side rook captured
-            //         } else if (toBB & BB(A1)) {
-            //             castling &= ~CR_WQ; // white queen side rook captured
-            //         }
-            //     } else {
-            //         if (toBB & BB(H8)) {
-            //             castling &= ~CR_BK; // black king side rook captured
-            //         } else if (toBB & BB(A8)) {
-            //             castling &= ~CR_BQ; // black queen side rook captured
-            //         }
-            //     }
-            // }
-        }
+        halfmoveClock++;
     }
 
-    // handle promotions
-    if (has(move.flags, MF_PromoMask)) {
-        // remove the pawn that promoted
-        bb[us][PAWN] &= ~toBB;
-
-        // add the promoted piece
-        if (has(move.flags, MF_PromoQ)) {
-            bb[us][QUEEN] |= toBB;
-        } else if (has(move.flags, MF_PromoR)) {
-            bb[us][ROOK] |= toBB;
-        } else if (has(move.flags, MF_PromoB)) {
-            bb[us][BISHOP] |= toBB;
-        } else if (has(move.flags, MF_PromoN)) {
-            bb[us][KNIGHT] |= toBB;
-        } 
-        // else {
-        //     assert(false); // invalid promotion flag
-        // }
-    }
-
-    // handle castling
-    assert(!(has(move.flags, MF_CastleK) && has(move.flags, MF_CastleQ))); // can't castle both sides at once
-    if (has(move.flags, MF_CastleK)) {
-        if (us == WHITE) {
-            // move the rook from h1 to f1
-            bb[WHITE][ROOK] &= ~BB(H1);
-            bb[WHITE][ROOK] |= BB(F1);
-            // update castling rights
-            castling &= ~(CR_WK | CR_WQ); // white king moved
-        } else { // us == BLACK
-            // move the rook from h8 to f8
-            bb[BLACK][ROOK] &= ~BB(H8);
-            bb[BLACK][ROOK] |= BB(F8);
-            // update castling rights
-            castling &= ~(CR_BK | CR_BQ); // black king moved
-        }
-    } else if (has(move.flags, MF_CastleQ)) {
-        if (us == WHITE) {
-            // move the rook from a1 to d1
-            bb[WHITE][ROOK] &= ~BB(A1);
-            bb[WHITE][ROOK] |= BB(D1);
-            // update castling rights
-            castling &= ~(CR_WK | CR_WQ); // white king moved
-        } else { // us == BLACK
-            // move the rook from a8 to d8
-            bb[BLACK][ROOK] &= ~BB(A8);
-            bb[BLACK][ROOK] |= BB(D8);
-            // update castling rights
-            castling &= ~(CR_BK | CR_BQ); // black king moved
-        }
+    sideToMove = Them; // change turn
+    key ^= ZOBRIST.side;
+    if constexpr (Them == WHITE) ++fullmoveNumber;
+}
+
+void Board::unmakeMove(const Move& move) {
+    // the side that made the move is the one not to move now
+    if (sideToMove == BLACK) unmakeMove<WHITE>(move);
+    else                     unmakeMove<BLACK>(move);
+}
+
+template <Color Us>
+void Board::unmakeMove(const Move& move) {
+    using S = SideSquares<Us>;
+    constexpr Color Them = other(Us);
+    assert(st != nullptr); // needs the StateInfo pushed by makeMove
+
+    const int from = move.from();
+    const int to = move.to();
+    const U16 flags = move.flags();
+
+    sideToMove = Us;
+    if constexpr (Us == BLACK) --fullmoveNumber;
+
+    // nothing to record for the NNUE: the accumulator before the move is the previous record's
+    const NnueNetwork* net = accNet;
+    accNet = nullptr;
+
+    // undo promotion: the piece on "to" becomes a pawn again before going back
+    if (has(flags, MF_PromoMask)) {
+        removePiece(Us, promoPiece(flags), to);
+        putPiece(Us, PAWN, to);
     }
 
-    // update castling rights
-    if (move.piece == KING) {
-        if (us == WHITE) {
-            castling &= ~(CR_WK | CR_WQ); // white king moved, remove both rights
-        } else {
-            castling &= ~(CR_BK | CR_BQ); // black king moved, remove both rights
-        }
-    } else if (move.piece == ROOK) {
-        if (us == WHITE) {
-            if (fromBB & BB(H1)) {
-                castling &= ~CR_WK; // white king side rook moved
-            } else if (fromBB & BB(A1)) {
-                castling &= ~CR_WQ; // white queen side rook moved
-            }
-        } else {
-            if (fromBB & BB(H8)) {
-                castling &= ~CR_BK; // black king side rook moved
-            } else if (fromBB & BB(A8)) {
-                castling &= ~CR_BQ; // black queen side rook moved
-            }
-        }
+    movePiece(Us, mailbox[to], to, from);
+
+    if (has(flags, MF_CastleK)) {
+        movePiece(Us, ROOK, S::RookKTo, S::RookK);
+    } else if (has(flags, MF_CastleQ)) {
+        movePiece(Us, ROOK, S::RookQTo, S::RookQ);
     }
 
-    if (move.piece == PAWN || has(move.flags, MF_Capture)) {
-        halfmoveClock = 0;
-    } else {
-        halfmoveClock++;
+    // put the captured piece back
+    if (has(flags, MF_EnPassant)) {
+        putPiece(Them, PAWN, to - S::Up);
+    } else if (st->captured != PIECE_N) {
+        putPiece(Them, st->captured, to);
     }
 
-    // update occupancies
-    recompute();
-    sideToMove = them; // change turn
-    if (sideToMove == WHITE) ++fullmoveNumber; 
+    castling = st->castling;
+    epTarget = st->epTarget;
+    halfmoveClock = st->halfmoveClock;
+    key = st->key; // pieces already toggled back, this also restores side/castling/ep
+    historyPlies = st->historyPlies;
+    accNet = net;
+    if (st == accRoot) {
+        // the board's own accumulator was for the position after this move: rebuild it
+        accRoot = st->prev;
+        if (accNet) {
+            nnueRefresh(*this, WHITE);
+            nnueRefresh(*this, BLACK);
+        }
+    }
+    st = st->prev; // pop
+}
+
+void Board::makeNullMove(StateInfo& newSt) {
+    newSt.castling = castling;
+    newSt.epTarget = epTarget;
+    newSt.halfmoveClock = halfmoveClock;
+    newSt.captured = PIECE_N;
+    newSt.key = key;
+    newSt.historyPlies = historyPlies;
+    if (accNet) {
+        newSt.dirty = NnueDirty{}; // no piece changes: the accumulator is copied when needed
+        newSt.accComputed[WHITE] = newSt.accComputed[BLACK] = false;
+    }
+    newSt.prev = st;
+    st = &newSt;
+    historyPlies = 0; // passing is not a move of the game, no repetition across it
+
+    if (epTarget) key ^= ZOBRIST.epFile[getSquare(epTarget) % 8];
+    epTarget = 0;
+    halfmoveClock++;
+    sideToMove = other(sideToMove);
+    key ^= ZOBRIST.side;
+    if (sideToMove == WHITE) ++fullmoveNumber;
+}
+
+void Board::unmakeNullMove() {
+    assert(st != nullptr);
+    sideToMove = other(sideToMove);
+    if (sideToMove == BLACK) --fullmoveNumber;
+    epTarget = st->epTarget;
+    halfmoveClock = st->halfmoveClock;
+    key = st->key;
+    historyPlies = st->historyPlies;
+    if (st == accRoot) accRoot = st->prev; // the pieces, and so the accumulator, are the same
+    st = st->prev;
+}
+
+void Board::applyMove(const Move& move) {
+    // same as makeMove, but the undo record is dropped right away: the accumulator it
+    // would carry becomes the board's own
+    StateInfo tmp;
+    makeMove(move, tmp);
+    if (accNet) {
+        std::memcpy(acc[WHITE], nnueAccumulator(*this, WHITE), sizeof(acc[WHITE]));
+        std::memcpy(acc[BLACK], nnueAccumulator(*this, BLACK), sizeof(acc[BLACK]));
+    }
+    st = tmp.prev;
+    accRoot = st;
+    historyPlies = 0; // the record is gone, and the history with it
 }
 
 Board Board::applied(const Move& move) const {
@@ -362,89 +424,201 @@ Board Board::applied(const Move& move) const {
     return newBoard; // return the new board state
 }
 
-bool Board::canCastleKingSide(Color c) const {
-    if (c == WHITE) {
-        return (hasWK() && // king or rook has not moved
-                (bb[WHITE][ROOK] & BB(H1)) && // rook is on h1 (and has not been captured which is not checked in hasWK())
-                !(occAll & ( BB(F1) | BB(G1) ) ) && // squares between king and rook are empty  
-                !isSquareAttacked(E1, BLACK) && // king not in check
-                !isSquareAttacked(F1, BLACK) && // king not passing through check
-                !isSquareAttacked(G1, BLACK)); // king not moving into check 
+U64 Board::keyAfter(const Move& move) const {
+    const Color us = sideToMove;
+    const int from = move.from(), to = move.to();
+    const Piece piece = mailbox[from];
+    U64 k = key ^ ZOBRIST.side ^ ZOBRIST.piece[us][piece][from] ^ ZOBRIST.piece[us][piece][to];
+    if ((move.flags() & (MF_Capture | MF_EnPassant)) == MF_Capture)
+        k ^= ZOBRIST.piece[other(us)][mailbox[to]][to];
+    return k;
+}
 
-    } else { // black to move
-        return (hasBK() && // king or rook has not moved
-                (bb[BLACK][ROOK] & BB(H8)) && // rook is on h8 (and has not been captured which is not checked in hasBK())
-                !(occAll & ( BB(F8) | BB(G8) ) ) && // squares between king and rook are empty  
-                !isSquareAttacked(E8, WHITE) && // king not in check
-                !isSquareAttacked(F8, WHITE) && // king not passing through check
-                !isSquareAttacked(G8, WHITE)); // king not moving into check
-    }
+bool Board::canCastleKingSide(Color c) const {
+    return c == WHITE ? canCastle<WHITE, true>() : canCastle<BLACK, true>();
 }
 
 bool Board::canCastleQueenSide(Color c) const {
-    if (c == WHITE) {
-        return (hasWQ() && // king or rook has not moved
-                (bb[WHITE][ROOK] & BB(A1)) && // rook is on a1 (and has not been captured which is not checked in hasWQ())
-                !(occAll & ( BB(D1) | BB(C1) | BB(B1) ) ) && // squares between king and rook are empty  
-                !isSquareAttacked(E1, BLACK) && // king not in check
-                !isSquareAttacked(D1, BLACK) && // king not passing through check
-                !isSquareAttacked(C1, BLACK)); // king not moving into check 
+    return c == WHITE ? canCastle<WHITE, false>() : canCastle<BLACK, false>();
+}
 
-    } else { // black to move
-        return (hasBQ() && // king or rook has not moved
-                (bb[BLACK][ROOK] & BB(A8)) && // rook is on a8 (and has not been captured which is not checked in hasBQ())
-                !(occAll & ( BB(D8) | BB(C8) | BB(B8) ) ) && // squares between king and rook are empty
-                !isSquareAttacked(E8, WHITE) && // king not in check
-                !isSquareAttacked(D8, WHITE) && // king not passing through check
-                !isSquareAttacked(C8, WHITE)); // king not moving into check
-    }
+template <Color Us, bool KingSide>
+bool Board::canCastle() const {
+    using S = SideSquares<Us>;
+    constexpr Color Them = other(Us);
+    constexpr Square rook = KingSide ? S::RookK : S::RookQ;
+    constexpr Square passing = KingSide ? S::RookKTo : S::RookQTo;
+    constexpr Square kingTo = KingSide ? S::KingKTo : S::KingQTo;
+    return (castling & (KingSide ? S::CastleK : S::CastleQ)) && // king and rook not moved, rook not captured
+           // rook is home: makeMove drops the right when the rook moves or is captured
+           // (CASTLING_KEEP), so this only guards against rights a FEN gives without the rook
+           (bb[Us][ROOK] & BB(rook)) &&
+           !(occAll & (KingSide ? S::PathK : S::PathQ)) && // squares between king and rook are empty
+           !isSquareAttacked<Them>(S::King) && // king not in check
+           !isSquareAttacked<Them>(passing) && // king not passing through check
+           !isSquareAttacked<Them>(kingTo); // king not moving into check
 }
 
-std::vector<Move> Board::generateMoves() const {
-    std::vector<Move> moves;
-    for (int p = 0; p < PIECE_N; ++p) {
-        U64 pieces = bb[sideToMove][p];
-        while (pieces) {
-            U64 pieceBoard = pieces & -pieces; // get lowest set bit
-            int sq = getSquare(pieceBoard);
-            // call coresponding function from function array
-            pieceFunctionArray[p](moves, pieceBoard, sq, sideToMove, *this); // appends generated moves to moves vector
-            pieces &= pieces - 1; // clear lowest set bit
-        }
-    }
-    return moves;
+void Board::generateMoves(MoveList& moves) const {
+    if (sideToMove == WHITE) generatePseudo<WHITE>(moves);
+    else                     generatePseudo<BLACK>(moves);
 }
 
-std::vector<Move> Board::generateLegalMoves() const {
-    std::vector<Move> legal;
-    auto pseudo = generateMoves();
-    legal.reserve(pseudo.size());
+template <Color Us>
+void Board::generatePseudo(MoveList& moves) const {
+    // no target restriction: checks and pins are left to the caller
+    genPawnMoves<Us>(moves, bb[Us][PAWN], ~0ULL);
+    genPieceMoves<Us, KNIGHT>(moves, bb[Us][KNIGHT], ~0ULL, 0, A1);
+    genPieceMoves<Us, BISHOP>(moves, bb[Us][BISHOP], ~0ULL, 0, A1);
+    genPieceMoves<Us, ROOK>  (moves, bb[Us][ROOK],   ~0ULL, 0, A1);
+    genPieceMoves<Us, QUEEN> (moves, bb[Us][QUEEN],  ~0ULL, 0, A1);
+    if (bb[Us][KING]) {
+        const int kingSq = getSquare(bb[Us][KING]);
+        push_moves(moves, kingSq, KING_ATTACK_TARGETS[kingSq] & ~occ[Us], occ[other(Us)]);
+        genCastling<Us>(moves, kingSq);
+    }
+}
 
-    const Color us = sideToMove;
+void Board::generateLegalMoves(MoveList& legal, GenType type, U64 fromMask) const {
+    const U64 checkersBB = checkers();
+    // in check every legal move is an evasion
+    if (checkersBB && type == GEN_ALL) type = GEN_EVASIONS;
+    assert(type != GEN_EVASIONS || checkersBB);
+
+    const bool white = sideToMove == WHITE;
+    switch (type) {
+    case GEN_ALL:
+        return white ? generateLegal<WHITE, GEN_ALL>(legal, fromMask, checkersBB)
+                     : generateLegal<BLACK, GEN_ALL>(legal, fromMask, checkersBB);
+    case GEN_CAPTURES:
+        return white ? generateLegal<WHITE, GEN_CAPTURES>(legal, fromMask, checkersBB)
+                     : generateLegal<BLACK, GEN_CAPTURES>(legal, fromMask, checkersBB);
+    case GEN_QUIETS:
+        return white ? generateLegal<WHITE, GEN_QUIETS>(legal, fromMask, checkersBB)
+                     : generateLegal<BLACK, GEN_QUIETS>(legal, fromMask, checkersBB);
+    case GEN_EVASIONS:
+        return white ? generateLegal<WHITE, GEN_EVASIONS>(legal, fromMask, checkersBB)
+                     : generateLegal<BLACK, GEN_EVASIONS>(legal, fromMask, checkersBB);
+    }
+}
 
-    for (const Move& m : pseudo) {
-        Board newBoard = *this;
-        newBoard.applyMove(m);
-        if (!newBoard.isInCheck(us)) {
-            legal.push_back(m);
+template <Color Us, GenType Type>
+void Board::generateLegal(MoveList& legal, U64 fromMask, U64 checkersBB) const {
+    using S = SideSquares<Us>;
+    constexpr Color Them = other(Us);
+    const U64 kingBB = bb[Us][KING];
+    const Square kingSq = getSquare(kingBB);
+
+    // the king may go to any square that is not attacked once it has left its own square
+    // (so a slider checking along a line also covers the square behind the king)
+    U64 kingTargets = (kingBB & fromMask) ? (KING_ATTACK_TARGETS[kingSq] & ~occ[Us]) : 0;
+    if constexpr (Type == GEN_CAPTURES) kingTargets &= occ[Them];
+    if constexpr (Type == GEN_QUIETS) kingTargets &= ~occ[Them];
+    U64 safe = 0;
+    while (kingTargets) {
+        U64 toBB = kingTargets & -kingTargets;
+        if (!(attackersTo(getSquare(toBB), occAll ^ kingBB) & occ[Them])) safe |= toBB;
+        kingTargets ^= toBB;
+    }
+
+    // captures only: the king takes first, the other types add its moves last
+    if constexpr (Type == GEN_CAPTURES) push_moves(legal, kingSq, safe, occ[Them]);
+
+    // double check: only the king can move
+    if (checkersBB & (checkersBB - 1)) {
+        if constexpr (Type != GEN_CAPTURES) push_moves(legal, kingSq, safe, occ[Them]);
+        return;
+    }
+
+    // single check: capture the checker or block the line to it
+    const U64 checkMask = checkersBB ? (checkersBB | BETWEEN_BB[kingSq][getSquare(checkersBB)]) : ~0ULL;
+    const U64 pinned = pinnedPieces(Us);
+
+    // pieces aim at enemy pieces (captures) or empty squares (quiets); pawns capture en
+    // passant and promote in the captures, so their quiets leave out those squares
+    U64 pieceMask = checkMask, pawnMask = checkMask;
+    if constexpr (Type == GEN_CAPTURES) {
+        pieceMask &= occ[Them];
+        pawnMask &= occ[Them] | epTarget | S::PromoRank;
+    } else if constexpr (Type == GEN_QUIETS) {
+        pieceMask &= ~occAll;
+        pawnMask &= ~occAll & ~epTarget & ~S::PromoRank;
+    }
+
+    const U64 pawns = bb[Us][PAWN] & fromMask;
+    genPawnMoves<Us>(legal, pawns & ~pinned, pawnMask);
+    // a pinned pawn may only move along the line through its king
+    for (U64 p = pawns & pinned; p; p &= p - 1) {
+        const int sq = getSquare(p);
+        genPawnMoves<Us>(legal, BB(sq), pawnMask & LINE_BB[kingSq][sq]);
+    }
+    // a pinned knight can never move
+    genPieceMoves<Us, KNIGHT>(legal, bb[Us][KNIGHT] & fromMask & ~pinned, pieceMask, 0, kingSq);
+    genPieceMoves<Us, BISHOP>(legal, bb[Us][BISHOP] & fromMask, pieceMask, pinned, kingSq);
+    genPieceMoves<Us, ROOK>  (legal, bb[Us][ROOK]   & fromMask, pieceMask, pinned, kingSq);
+    genPieceMoves<Us, QUEEN> (legal, bb[Us][QUEEN]  & fromMask, pieceMask, pinned, kingSq);
+
+    if constexpr (Type != GEN_CAPTURES) {
+        push_moves(legal, kingSq, safe, occ[Them]);
+        // never out of a check; canCastle tests the squares itself
+        if constexpr (Type != GEN_EVASIONS) {
+            if (kingBB & fromMask) genCastling<Us>(legal, kingSq);
         }
     }
+}
 
-    return legal;
+std::vector<Move> Board::generateMoves() const {
+    MoveList moves;
+    generateMoves(moves);
+    return std::vector<Move>(moves.begin(), moves.end());
+}
+
+std::vector<Move> Board::generateLegalMoves() const {
+    MoveList moves;
+    generateLegalMoves(moves);
+    return std::vector<Move>(moves.begin(), moves.end());
 }
 
 bool Board::hasLegalMove() const {
-    auto pseudo = generateMoves();
-    const Color us = sideToMove;
+    MoveList moves;
+    generateLegalMoves(moves);
+    return !moves.empty();
+}
 
-    for (const Move& m : pseudo) {
-        Board newBoard = *this;
-        newBoard.applyMove(m);
-        if (!newBoard.isInCheck(us)) {
-            return true; 
-        }
+U64 Board::checkers() const {
+    return attackersTo(getSquare(bb[sideToMove][KING])) & occ[other(sideToMove)];
+}
+
+U64 Board::pinnedPieces(Color c) const {
+    const Color them = other(c);
+    const Square kingSq = getSquare(bb[c][KING]);
+
+    // enemy sliders that would hit the king on an empty board
+    U64 snipers = (bishopAttacks(kingSq, 0) & (bb[them][BISHOP] | bb[them][QUEEN]))
+                | (rookAttacks(kingSq, 0)   & (bb[them][ROOK]   | bb[them][QUEEN]));
+
+    U64 pinned = 0;
+    while (snipers) {
+        int sniperSq = getSquare(snipers);
+        U64 blockers = BETWEEN_BB[kingSq][sniperSq] & occAll;
+        // exactly one piece in between, and it is ours
+        if (blockers && !(blockers & (blockers - 1))) pinned |= blockers & occ[c];
+        snipers &= snipers - 1;
     }
-    return false; 
+    return pinned;
+}
+
+bool Board::epIsSafe(int from, int to, Color c) const {
+    if (!bb[c][KING]) return true; // nothing to expose (hand made test positions)
+
+    const Color them = other(c);
+    const Square kingSq = getSquare(bb[c][KING]);
+    const int capturedSq = (c == WHITE) ? to - 8 : to + 8;
+
+    // both pawns leave their squares at once, which can open a rank (or diagonal) to the king
+    const U64 after = (occAll ^ BB(from) ^ BB(capturedSq)) | BB(to);
+    return !(bishopAttacks(kingSq, after) & (bb[them][BISHOP] | bb[them][QUEEN])) &&
+           !(rookAttacks(kingSq, after)   & (bb[them][ROOK]   | bb[them][QUEEN]));
 }
 
 bool Board::isCheckmate() const {
@@ -460,426 +634,215 @@ GameState Board::state() const {
         return CHECKMATE;
     } else if (isStalemate()) {
         return STALEMATE;
+    } else if (isFiftyMoveDraw()) {
+        return FIFTY_MOVES;
+    } else if (isRepetition(0)) {
+        return REPETITION;
     } else {
         return PLAYING;
     }
 }
 
-void Board::push_promos(std::vector<Move>& moves, int from, int to, U16 baseFlags) {
-    Move moveQ;
-    moveQ.from = from;
-    moveQ.to = to;
-    moveQ.flags = baseFlags | MF_PromoQ;
-    moveQ.piece = PAWN;
-    moves.push_back(moveQ);
-
-    Move moveR;
-    moveR.from = from;
-    moveR.to = to;
-    moveR.flags = baseFlags | MF_PromoR;
-    moveR.piece = PAWN;
-    moves.push_back(moveR);
-
-    Move moveB;
-    moveB.from = from;
-    moveB.to = to;
-    moveB.flags = baseFlags | MF_PromoB;
-    moveB.piece = PAWN;
-    moves.push_back(moveB);
-
-    Move moveN;
-    moveN.from = from;
-    moveN.to = to;
-    moveN.flags = baseFlags | MF_PromoN;
-    moveN.piece = PAWN;
-    moves.push_back(moveN);
-} 
-
-void Board::genPawnMoves(std::vector<Move>& moves, U64 pawnBB, int sq, Color c, const Board& board) {
-    if (c == WHITE) {
-        if ((pawnBB << 8) & ~board.occAll) { // single push
-            int toSq = sq + 8;
-            if (pawnBB & RANK_7) {
-                // promotion moves
-                push_promos(moves, sq, toSq, MF_None);
-            } else {
-                Move move;
-                move.from = sq;
-                move.to = toSq;
-                move.flags = MF_None;
-                move.piece = PAWN;
-                moves.push_back(move);
-            }
-
-            if ( (pawnBB & RANK_2) && ( (pawnBB << 16) & ~board.occAll ) ) { // double push from rank 2
-                Move move2;
-                move2.from = sq;
-                move2.to = sq + 16;
-                move2.flags = MF_DoublePush;
-                move2.piece = PAWN;
-                moves.push_back(move2);
-            }
-        }
-
-        //captures
-        if ((pawnBB & ~FILE_A) << 7 & board.occ[other(c)]) { // capture to the left
-            int toSq = sq + 7;
-            U64 toBB = BB(toSq);
-            if (toBB & RANK_8) { 
-                // promotion capture moves
-                push_promos(moves, sq, toSq, MF_Capture);
-            } else {
-            Move move;
-            move.from = sq;
-            move.to = toSq;
-            move.flags = MF_Capture;
-            move.piece = PAWN;
-            moves.push_back(move);
-            }
-        }
-        if ((pawnBB & ~FILE_H) << 9 & board.occ[other(c)]) { // capture to the right
-            int toSq = sq + 9;
-            U64 toBB = BB(toSq);
-            if (toBB & RANK_8) { 
-                // promotion capture moves
-                push_promos(moves, sq, toSq, MF_Capture);
-            } else {
-            Move move;
-            move.from = sq;
-            move.to = toSq;
-            move.flags = MF_Capture;
-            move.piece = PAWN;
-            moves.push_back(move);
-            }
-        }
-
-        // en passant captures
-        if (board.hasEP()) {
-            U64 enPawnBB = ( (pawnBB & ~FILE_A) << 7 ) & board.epTarget; // capture to the left
-            if (enPawnBB) { 
-                int toSq = getSquare(enPawnBB);
-                Move move;
-                move.from = sq;
-                move.to = toSq;
-                move.flags = MF_EnPassant | MF_Capture;
-                move.piece = PAWN;
-                moves.push_back(move);
-            }
-            enPawnBB = ( (pawnBB & ~FILE_H) << 9 ) & board.epTarget; // capture to the right
-            if (enPawnBB) {
-                int toSq = getSquare(enPawnBB);
-                Move move;
-                move.from = sq;
-                move.to = toSq;
-                move.flags = MF_EnPassant | MF_Capture;
-                move.piece = PAWN;
-                moves.push_back(move);
-            }
-        }
+bool Board::isFiftyMoveDraw() const {
+    return halfmoveClock >= 100 && (!checkers() || hasLegalMove());
+}
 
-    } else { // black to move
-        if ((pawnBB >> 8) & ~board.occAll) { // single push
-            int toSq = sq - 8;
-            if (pawnBB & RANK_2) { 
-                // promotion moves
-                push_promos(moves, sq, toSq, MF_None);
-            } else {
-                Move move;
-                move.from = sq;
-                move.to = toSq;
-                move.flags = MF_None;
-                move.piece = PAWN;
-                moves.push_back(move);
-            }
+bool Board::isRepetition(int ply) const {
+    // the record n plies down the stack holds the key of n + 1 plies ago. A position
+    // comes back after 4 plies at the earliest, with the same side to move
+    const int end = std::min(halfmoveClock, historyPlies);
+    if (end < 4) return false;
+    const StateInfo* s = st->prev->prev->prev;
+    int seen = 0;
+    for (int d = 4; ; d += 2) {
+        if (s->key == key && (d < ply || ++seen == 2)) return true;
+        if (d + 2 > end) return false;
+        s = s->prev->prev;
+    }
+}
 
-            if ((pawnBB & RANK_7) && ( (pawnBB >> 16) & ~board.occAll )) { // double push from rank 7
-                Move move2;
-                move2.from = sq;
-                move2.to = sq - 16;
-                move2.flags = MF_DoublePush;
-                move2.piece = PAWN;
-                moves.push_back(move2);
-            }
-        }
-        //captures
-        if ((pawnBB & ~FILE_A) >> 9 & board.occ[other(c)]) { // capture to black players right
-            int toSq = sq - 9;
-            U64 toBB = BB(toSq);
-            if (toBB & RANK_1) { 
-                // promotion capture moves
-                push_promos(moves, sq, toSq, MF_Capture);
-            } else {
-            Move move;
-            move.from = sq;
-            move.to = toSq;
-            move.flags = MF_Capture;
-            move.piece = PAWN;
-            moves.push_back(move);
-            }
+namespace {
+
+// Cuckoo table of the reversible moves: every knight, bishop, rook, queen and king move
+// between two squares of an empty board, by the key difference it makes (both squares
+// and the side). Two positions whose keys differ by one of these are a single move
+// apart. 3668 moves in 8192 slots; a key sits in slot h1 or h2 of its hash.
+struct Cuckoo {
+    U64 key[8192];
+    uint8_t sq1[8192];
+    uint8_t sq2[8192];
+    int count;
+};
+
+constexpr int cuckooH1(U64 k) { return static_cast<int>(k & 0x1FFF); }
+constexpr int cuckooH2(U64 k) { return static_cast<int>((k >> 16) & 0x1FFF); }
+
+constexpr bool emptyBoardAttack(Piece p, int a, int b) {
+    const int df = a % 8 - b % 8, dr = a / 8 - b / 8;
+    const bool diagonal = df == dr || df == -dr;
+    const bool straight = df == 0 || dr == 0;
+    switch (p) {
+        case KNIGHT: return (KNIGHT_ATTACK_TARGETS[a] >> b) & 1;
+        case BISHOP: return diagonal;
+        case ROOK:   return straight;
+        case QUEEN:  return diagonal || straight;
+        case KING:   return (KING_ATTACK_TARGETS[a] >> b) & 1;
+        default:     return false;
+    }
+}
 
-        }
-        if ((pawnBB & ~FILE_H) >> 7 & board.occ[other(c)]) { // capture to black players left
-            int toSq = sq - 7;
-            U64 toBB = BB(toSq);
-            if (toBB & RANK_1) { 
-                // promotion capture moves
-                push_promos(moves, sq, toSq, MF_Capture);
-            } else {
-                Move move;
-                move.from = sq;
-                move.to = toSq;
-                move.flags = MF_Capture;
-                move.piece = PAWN;
-                moves.push_back(move);
+constexpr Cuckoo CUCKOO = []{
+    Cuckoo t{};
+    for (int c = 0; c < COLOR_N; ++c) {
+        for (int p = KNIGHT; p <= KING; ++p) {
+            for (int a = 0; a < 64; ++a) {
+                for (int b = a + 1; b < 64; ++b) {
+                    if (!emptyBoardAttack(static_cast<Piece>(p), a, b)) continue;
+                    U64 k = ZOBRIST.piece[c][p][a] ^ ZOBRIST.piece[c][p][b] ^ ZOBRIST.side;
+                    uint8_t s1 = static_cast<uint8_t>(a), s2 = static_cast<uint8_t>(b);
+                    // insert, kicking the occupant to its other slot until one is free
+                    int i = cuckooH1(k);
+                    while (true) {
+                        const U64 kk = t.key[i];
+                        const uint8_t k1 = t.sq1[i], k2 = t.sq2[i];
+                        t.key[i] = k; t.sq1[i] = s1; t.sq2[i] = s2;
+                        if (kk == 0) break;
+                        k = kk; s1 = k1; s2 = k2;
+                        i = (i == cuckooH1(k)) ? cuckooH2(k) : cuckooH1(k);
+                    }
+                    ++t.count;
+                }
             }
         }
-
-        // en passant captures
-        if (board.hasEP()) {
-            U64 enPawnBB = ( (pawnBB & ~FILE_A) >> 9 ) & board.epTarget; // capture to the left
-            if (enPawnBB) { 
-                int toSq = getSquare(enPawnBB);
-                Move move;
-                move.from = sq;
-                move.to = toSq;
-                move.flags = MF_EnPassant | MF_Capture;
-                move.piece = PAWN;
-                moves.push_back(move);
-            }
-            enPawnBB = ( (pawnBB & ~FILE_H) >> 7 ) & board.epTarget; // capture to the right
-            if (enPawnBB) {
-                int toSq = getSquare(enPawnBB);
-                Move move;
-                move.from = sq;
-                move.to = toSq;
-                move.flags = MF_EnPassant | MF_Capture;
-                move.piece = PAWN;
-                moves.push_back(move);
-            }
+    }
+    return t;
+}();
+
+static_assert(CUCKOO.count == 3668);
+
+} // namespace
+
+bool Board::hasUpcomingRepetition(int ply) const {
+    // the positions 3, 5, 7... plies ago had the other side to move: one move of ours
+    // away. other is 0 when the pieces differ from that position by our move keys only
+    const int end = std::min(halfmoveClock, historyPlies);
+    if (end < 3) return false;
+    const StateInfo* s = st;
+    U64 other = key ^ s->key ^ ZOBRIST.side;
+    for (int d = 3; d <= end; d += 2) {
+        s = s->prev;
+        other ^= s->key ^ s->prev->key ^ ZOBRIST.side;
+        s = s->prev;
+        if (other != 0) continue;
+
+        const U64 moveKey = key ^ s->key;
+        int i = cuckooH1(moveKey);
+        if (CUCKOO.key[i] != moveKey) {
+            i = cuckooH2(moveKey);
+            if (CUCKOO.key[i] != moveKey) continue;
         }
+        // the move is only playable if nothing stands in between; positions before the
+        // root of the search would need more care (whose move, threefold), leave them
+        if (!(BETWEEN_BB[CUCKOO.sq1[i]][CUCKOO.sq2[i]] & occAll) && d < ply) return true;
     }
+    return false;
 }
 
-void Board::genKnightMoves(std::vector<Move>& moves, U64 knightBB, int sq, Color c, const Board& board) {
-    // to get rid of unused variable warning
-    (void)knightBB;
-
-    const U64 own = board.occ[c];
-
-    // original computing knight attacks every time
-    // U64 from = knightBB;
-    // U64 attack  = 0;
+void Board::push_promos(MoveList& moves, int from, int to, U16 baseFlags) {
+    moves.push_back(Move(from, to, baseFlags | MF_PromoQ));
 
-    // attack |= (from & ~FILE_H)  << 17;
-    // attack |= (from & ~FILE_A)  << 15;
-    // attack |= (from & ~FILE_GH) << 10;
-    // attack |= (from & ~FILE_AB) <<  6;
-    // attack |= (from & ~FILE_H)  >> 15;
-    // attack |= (from & ~FILE_A)  >> 17;
-    // attack |= (from & ~FILE_GH) >>  6;
-    // attack |= (from & ~FILE_AB) >> 10;
+    moves.push_back(Move(from, to, baseFlags | MF_PromoR));
 
-    // U64 targets = attack & ~own;
+    moves.push_back(Move(from, to, baseFlags | MF_PromoB));
 
-    // using precomputed knight attack targets defined in types.hpp
-    U64 targets = KNIGHT_ATTACK_TARGETS[sq] & ~own;
+    moves.push_back(Move(from, to, baseFlags | MF_PromoN));
+} 
 
+void Board::push_moves(MoveList& moves, int from, U64 targets, U64 enemy) {
     while (targets) {
         U64 toBB = targets & -targets;
-        int to   = getSquare(toBB);
-        const U16 flag = (toBB & board.occ[other(c)]) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = to;
-        move.flags = flag;
-        move.piece = KNIGHT;
-        moves.push_back(move);
+        moves.push_back(Move(from, getSquare(toBB), (toBB & enemy) ? MF_Capture : MF_None));
         targets ^= toBB;
     }
 }
 
-void Board::genDiagonalMoves(std::vector<Move>& moves, U64 pieceBB, int sq, Color c, const Board& board, Piece piece) {
-    const U64 own = board.occ[c];
-    const U64 enemy = board.occ[other(c)];
-
-    U64 p = pieceBB;
-
-    // north-east
-    while(( p = ( (p & ~FILE_H & ~RANK_8) << 9 ) )) { 
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-
-    // north-west
-    p = pieceBB;
-    while(( p = ( (p & ~FILE_A & ~RANK_8) << 7 ) )) { 
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-
-    // south-east
-    p = pieceBB;
-    while(( p = ( (p & ~FILE_H & ~RANK_1) >> 7 ) )){ 
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-
-    // south-west
-    p = pieceBB;
-    while(( p = ( (p & ~FILE_A & ~RANK_1) >> 9 ) )) { 
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-}
-
-void Board::genStraightMoves(std::vector<Move>& moves, U64 pieceBB, int sq, Color c, const Board& board, Piece piece) {
-    const U64 own = board.occ[c];
-    const U64 enemy = board.occ[other(c)];
-
-    U64 p = pieceBB;
-
-    // north
-    while(( p = ( (p & ~RANK_8) << 8 ) )) {
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-
-    // south
-    p = pieceBB;
-    while(( p = ( (p & ~RANK_1) >> 8 ) )) {
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-
-    // east
-    p = pieceBB;
-    while(( p = ( (p & ~FILE_H) << 1 ) )) {
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-
-    // west
-    p = pieceBB;
-    while(( p = ( (p & ~FILE_A) >> 1 ) )) {
-        if (p & own) break; 
-        const U16 flag = (p & enemy) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = getSquare(p);
-        move.flags = flag;
-        move.piece = piece;
-        moves.push_back(move);
-        if (flag == MF_Capture) break; // stop if we captured
-    }
-}
-
-void Board::genBishopMoves(std::vector<Move>& moves, U64 bishopBB, int sq, Color c, const Board& board) {
-    genDiagonalMoves(moves, bishopBB, sq, c, board, BISHOP);
-}
-
-void Board::genRookMoves(std::vector<Move>& moves, U64 rookBB, int sq, Color c, const Board& board) {
-    genStraightMoves(moves, rookBB, sq, c, board, ROOK);
-}
-
-void Board::genQueenMoves(std::vector<Move>& moves, U64 queenBB, int sq, Color c, const Board& board) {
-    genDiagonalMoves(moves, queenBB, sq, c, board, QUEEN);
-    genStraightMoves(moves, queenBB, sq, c, board, QUEEN);  
-}
-
-void Board::genKingMoves(std::vector<Move>& moves, U64 kingBB, int sq, Color c, const Board& board) {
-    // to get rid of unused variable warning
-    (void)kingBB;
-
-    const U64 own = board.occ[c];
-
-    U64 targets = KING_ATTACK_TARGETS[sq] & ~own;
-
-    while (targets) {
-        U64 toBB = targets & -targets;
-        int to   = getSquare(toBB);
-        const U16 flag = (toBB & board.occ[other(c)]) ? MF_Capture : MF_None;
-        Move move;
-        move.from = sq;
-        move.to = to;
-        move.flags = flag;
-        move.piece = KING;
-        moves.push_back(move);
-        targets ^= toBB;
+template <Color Us>
+void Board::genPawnMoves(MoveList& moves, U64 pawns, U64 targets) const {
+    using S = SideSquares<Us>;
+    const U64 empty = ~occAll;
+    const U64 enemy = occ[other(Us)];
+
+    // pushes: the double push goes on from a single push that lands on the third rank
+    U64 push1 = shift<S::Up>(pawns) & empty;
+    U64 push2 = shift<S::Up>(push1 & S::DoublePushRank) & empty & targets;
+    push1 &= targets;
+    // captures towards each side; the file mask stops the shift wrapping around the board
+    U64 capWest = shift<S::UpWest>(pawns & ~FILE_A) & enemy & targets;
+    U64 capEast = shift<S::UpEast>(pawns & ~FILE_H) & enemy & targets;
+
+    for (U64 t = push1 & S::PromoRank; t; t &= t - 1) {
+        const int to = getSquare(t);
+        push_promos(moves, to - S::Up, to, MF_None);
+    }
+    for (U64 t = capWest & S::PromoRank; t; t &= t - 1) {
+        const int to = getSquare(t);
+        push_promos(moves, to - S::UpWest, to, MF_Capture);
+    }
+    for (U64 t = capEast & S::PromoRank; t; t &= t - 1) {
+        const int to = getSquare(t);
+        push_promos(moves, to - S::UpEast, to, MF_Capture);
+    }
+
+    for (push1 &= ~S::PromoRank; push1; push1 &= push1 - 1) {
+        const int to = getSquare(push1);
+        moves.push_back(Move(to - S::Up, to, MF_None));
+    }
+    for (; push2; push2 &= push2 - 1) {
+        const int to = getSquare(push2);
+        moves.push_back(Move(to - 2 * S::Up, to, MF_DoublePush));
+    }
+    for (capWest &= ~S::PromoRank; capWest; capWest &= capWest - 1) {
+        const int to = getSquare(capWest);
+        moves.push_back(Move(to - S::UpWest, to, MF_Capture));
+    }
+    for (capEast &= ~S::PromoRank; capEast; capEast &= capEast - 1) {
+        const int to = getSquare(capEast);
+        moves.push_back(Move(to - S::UpEast, to, MF_Capture));
+    }
+
+    // en passant: allowed if landing on the target or removing the captured pawn answers
+    // a check, and the two pawns leaving the rank do not expose the king
+    if (epTarget && (targets & (epTarget | shift<-S::Up>(epTarget)))) {
+        const int to = getSquare(epTarget);
+        // our pawns that attack the target are the squares an enemy pawn there would attack
+        for (U64 from = pawns & PAWN_ATTACK_TARGETS[other(Us)][to]; from; from &= from - 1) {
+            if (epIsSafe(getSquare(from), to, Us)) moves.push_back(Move(getSquare(from), to, MF_EnPassant | MF_Capture));
+        }
     }
+}
 
-    // Castling moves
-    if (board.canCastleKingSide(c)) {
-        Square kingTo = (c == WHITE) ? G1 : G8;
-        Move move;
-        move.from = sq;
-        move.to = kingTo;
-        move.flags = MF_CastleK;
-        move.piece = KING;
-        moves.push_back(move);
-    }
-    if (board.canCastleQueenSide(c)) {
-        Square kingTo = (c == WHITE) ? C1 : C8;
-        Move move;
-        move.from = sq;
-        move.to = kingTo;
-        move.flags = MF_CastleQ;
-        move.piece = KING;
-        moves.push_back(move);
+template <Color Us, Piece P>
+void Board::genPieceMoves(MoveList& moves, U64 pieces, U64 targets, U64 pinned, Square kingSq) const {
+    static_assert(P == KNIGHT || P == BISHOP || P == ROOK || P == QUEEN);
+    targets &= ~occ[Us];
+    for (; pieces; pieces &= pieces - 1) {
+        const Square sq = getSquare(pieces);
+        U64 attacks;
+        if constexpr (P == KNIGHT)      attacks = KNIGHT_ATTACK_TARGETS[sq];
+        else if constexpr (P == BISHOP) attacks = bishopAttacks(sq, occAll);
+        else if constexpr (P == ROOK)   attacks = rookAttacks(sq, occAll);
+        else                            attacks = queenAttacks(sq, occAll);
+        // a pinned piece may only slide along the line through its king
+        if (pinned & BB(sq)) attacks &= LINE_BB[kingSq][sq];
+        push_moves(moves, sq, attacks & targets, occ[other(Us)]);
     }
 }
 
-
-
-
+template <Color Us>
+void Board::genCastling(MoveList& moves, int kingSq) const {
+    using S = SideSquares<Us>;
+    if (canCastle<Us, true>())  moves.push_back(Move(kingSq, S::KingKTo, MF_CastleK));
+    if (canCastle<Us, false>()) moves.push_back(Move(kingSq, S::KingQTo, MF_CastleQ));
+}
 
 } // namespace chess
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "chess/debug.hpp"
 #include "chess/board.hpp"
 #include "chess/defs.hpp"   
+#include <cstring>
 #include <ostream>          
 #include <iostream> // std::cout
 
@@ -26,21 +27,11 @@ void printBoard(const Board& b, std::ostream& os) {
         os << (rank + 1) << ' ';
         for (int file = 0; file < 8; ++file) {
             int sq = rank * 8 + file;
-            U64 m = BB(sq);
-
             char ch = '.';
-            if      (b.bb[WHITE][PAWN]   & m) ch = 'P';
-            else if (b.bb[WHITE][KNIGHT] & m) ch = 'N';
-            else if (b.bb[WHITE][BISHOP] & m) ch = 'B';
-            else if (b.bb[WHITE][ROOK]   & m) ch = 'R';
-            else if (b.bb[WHITE][QUEEN]  & m) ch = 'Q';
-            else if (b.bb[WHITE][KING]   & m) ch = 'K';
-            else if (b.bb[BLACK][PAWN]   & m) ch = 'p';
-            else if (b.bb[BLACK][KNIGHT] & m) ch = 'n';
-            else if (b.bb[BLACK][BISHOP] & m) ch = 'b';
-            else if (b.bb[BLACK][ROOK]   & m) ch = 'r';
-            else if (b.bb[BLACK][QUEEN]  & m) ch = 'q';
-            else if (b.bb[BLACK][KING]   & m) ch = 'k';
+            if (b.mailbox[sq] != PIECE_N) {
+                ch = "PNBRQK"[b.mailbox[sq]];
+                if (b.occ[BLACK] & BB(sq)) ch = static_cast<char>(ch - 'A' + 'a');
+            }
 
             os << ch << ' ';
         }
@@ -53,4 +44,37 @@ void printBoard(const Board& b) {
     printBoard(b, std::cout);
 }
 
+bool checkIncremental(const Board& b, std::ostream& os) {
+    Board fresh = b;
+    fresh.recompute();
+
+    bool ok = true;
+    if (fresh.occ[WHITE] != b.occ[WHITE] || fresh.occ[BLACK] != b.occ[BLACK] || fresh.occAll != b.occAll) {
+        os << "occupancy mismatch\n";
+        ok = false;
+    }
+    if (fresh.mailbox != b.mailbox) {
+        os << "mailbox mismatch\n";
+        ok = false;
+    }
+    if (fresh.key != b.key) {
+        os << "key mismatch: incremental=" << std::hex << b.key
+           << " recomputed=" << fresh.key << std::dec << "\n";
+        ok = false;
+    }
+    if (fresh.psqMg != b.psqMg || fresh.psqEg != b.psqEg || fresh.phase != b.phase) {
+        os << "eval accumulator mismatch: incremental mg=" << b.psqMg << " eg=" << b.psqEg << " phase=" << b.phase
+           << " recomputed mg=" << fresh.psqMg << " eg=" << fresh.psqEg << " phase=" << fresh.phase << "\n";
+        ok = false;
+    }
+    if (b.accNet && b.accNet == fresh.accNet
+        && (std::memcmp(nnueAccumulator(b, WHITE), fresh.acc[WHITE], sizeof(fresh.acc[WHITE])) != 0
+            || std::memcmp(nnueAccumulator(b, BLACK), fresh.acc[BLACK], sizeof(fresh.acc[BLACK])) != 0)) {
+        os << "nnue accumulator mismatch\n";
+        ok = false;
+    }
+    if (!ok) printBoard(b, os);
+    return ok;
+}
+
 } // namespace chess
\ No newline at end of file
@@ -0,0 +1,17 @@
+#include "chess/eval.hpp"
+#include "chess/board.hpp"
+
+#include <algorithm>
+
+namespace chess {
+
+int evaluate(const Board& b) {
+    if (b.accNet) return nnueEvaluate(b);
+
+    // promotions can push the phase past the opening value
+    const int mgPhase = std::min(b.phase, PHASE_MAX);
+    const int score = (b.psqMg * mgPhase + b.psqEg * (PHASE_MAX - mgPhase)) / PHASE_MAX; // white's point of view
+    return b.sideToMove == WHITE ? score : -score;
+}
+
+} // namespace chess
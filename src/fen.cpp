@@ -1,169 +1,281 @@
 #include "chess/fen.hpp"
 #include "chess/board.hpp"
 #include "chess/defs.hpp"   // Color, Piece, BB(), CR_* etc.
-#include <cctype>           // isdigit, isupper, tolower
-#include <sstream>          // istringstream, ostringstream
+#include <array>
+#include <bit>              // countr_zero
+#include <charconv>         // from_chars, to_chars
+#include <cstring>          // memcpy
 #include <string>
 
 namespace chess {
 
-// Map a single FEN piece char onto the board at square index `sq` (0..63).
-static bool putPiece(Board& b, int sq, char c) {
-    const bool isWhite = std::isupper(static_cast<unsigned char>(c)) != 0;
-    const Color col = isWhite ? WHITE : BLACK;
-    const char k = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-    Piece p;
-    switch (k) {
-        case 'p': p = PAWN;   break;
-        case 'n': p = KNIGHT; break;
-        case 'b': p = BISHOP; break;
-        case 'r': p = ROOK;   break;
-        case 'q': p = QUEEN;  break;
-        case 'k': p = KING;   break;
-        default: return false;
+// What a placement character stands for: a piece (colour << 3 | piece), a run of n empty
+// squares (PL_EMPTY + n), the rank separator, or nothing FEN knows. One table lookup per
+// character instead of a chain of comparisons.
+enum : uint8_t { PL_EMPTY = 16, PL_SLASH = 32, PL_BAD = 255 };
+
+static constexpr std::array<uint8_t, 256> PLACEMENT = [] {
+    std::array<uint8_t, 256> t{};
+    t.fill(PL_BAD);
+    constexpr std::string_view PIECE_CHARS = "PNBRQKpnbrqk";
+    for (std::size_t i = 0; i < PIECE_CHARS.size(); ++i) {
+        t[static_cast<unsigned char>(PIECE_CHARS[i])] = static_cast<uint8_t>((i / PIECE_N) << 3 | (i % PIECE_N));
     }
-    b.bb[col][p] |= BB(sq);
-    return true;
+    for (int n = 1; n <= 8; ++n) t['0' + n] = static_cast<uint8_t>(PL_EMPTY + n);
+    t['/'] = PL_SLASH;
+    return t;
+}();
+
+// the four position fields, read before anything is written to the board
+struct FenFields {
+    U64 bb[COLOR_N][PIECE_N] = {};
+    Color sideToMove = WHITE;
+    uint8_t castling = 0;
+    U64 epTarget = 0ULL;
+};
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
 }
 
-bool setFromFEN(Board& b, std::string_view fen) {
-    // Clear board bitboards
-    for (int c = 0; c < COLOR_N; ++c)
-        for (int p = 0; p < PIECE_N; ++p)
-            b.bb[c][p] = 0ULL;
+// Next whitespace-separated field of s, which is advanced past it ("" when none is left).
+// The field is a view into s: parsing copies nothing.
+static std::string_view nextField(std::string_view& s) {
+    std::size_t i = 0;
+    while (i < s.size() && isBlank(s[i])) ++i;
+    std::size_t j = i;
+    while (j < s.size() && !isBlank(s[j])) ++j;
+    const std::string_view field = s.substr(i, j - i);
+    s.remove_prefix(j);
+    return field;
+}
 
-    std::istringstream ss{std::string(fen)};  // simple tokenizer
-    std::string board, stm, cast, ep;
-    int half = 0, full = 1;
+// the whole field must be a number
+static bool parseInt(std::string_view field, int& out) {
+    const char* end = field.data() + field.size();
+    const auto [ptr, ec] = std::from_chars(field.data(), end, out);
+    return ec == std::errc{} && ptr == end;
+}
 
-    if (!(ss >> board >> stm >> cast >> ep >> half >> full)) {
-        return false; // wrong number of fields
-    }
+// error at a character of text
+static FenResult failAt(FenError e, std::string_view text, const char* at) {
+    return { e, static_cast<std::size_t>(at - text.data()) };
+}
 
-    // 1) Piece placement: ranks 8..1
-    int sq = 56;           // A8
-    int filesInRank = 0;
-    for (char ch : board) {
-        if (ch == '/') {
-            if (filesInRank != 8) return false;
-            sq -= 16;              // down one rank (A8 -> A7 -> ... -> A1)
-            filesInRank = 0;
-            continue;
-        }
-        if (std::isdigit(static_cast<unsigned char>(ch))) {
-            int run = ch - '0';
-            if (run < 1 || run > 8 || filesInRank + run > 8) return false;
-            sq += run;
-            filesInRank += run;
+// Read the placement, side, castling and en passant fields f[0..3] (views into text,
+// which error offsets are relative to).
+static FenResult readFields(std::string_view text, const std::string_view* f, FenFields& out) {
+    // 1) Piece placement: ranks 8..1, files a..h
+    const std::string_view board = f[0];
+    int rank = 7, file = 0;
+    for (const char& ch : board) {
+        const uint8_t code = PLACEMENT[static_cast<unsigned char>(ch)];
+        if (code < PL_EMPTY) {
+            if (file == 8) return failAt(FEN_BAD_RANK, text, &ch);
+            out.bb[code >> 3][code & 7] |= BB(rank * 8 + file);
+            ++file;
+        } else if (code < PL_SLASH) {
+            file += code - PL_EMPTY;
+            if (file > 8) return failAt(FEN_BAD_RANK, text, &ch);
+        } else if (code == PL_SLASH) {
+            if (file != 8) return failAt(FEN_BAD_RANK, text, &ch);
+            if (rank == 0) return failAt(FEN_BAD_RANK_COUNT, text, &ch);
+            --rank;
+            file = 0;
         } else {
-            if (!putPiece(b, sq, ch)) return false;
-            ++sq;
-            ++filesInRank;
+            return failAt(FEN_BAD_PIECE, text, &ch);
         }
     }
-    if (filesInRank != 8) return false;
+    const char* boardEnd = board.data() + board.size();
+    if (file != 8) return failAt(FEN_BAD_RANK, text, boardEnd);
+    if (rank != 0) return failAt(FEN_BAD_RANK_COUNT, text, boardEnd);
 
     // 2) Side to move
-    if (stm == "w")      b.sideToMove = WHITE;
-    else if (stm == "b") b.sideToMove = BLACK;
-    else return false;
+    if (f[1] == "w")      out.sideToMove = WHITE;
+    else if (f[1] == "b") out.sideToMove = BLACK;
+    else return failAt(FEN_BAD_SIDE, text, f[1].data());
 
     // 3) Castling rights
-    b.castling = 0;
-    if (cast != "-") {
-        for (char c : cast) {
-            if      (c == 'K') b.castling |= CR_WK;
-            else if (c == 'Q') b.castling |= CR_WQ;
-            else if (c == 'k') b.castling |= CR_BK;
-            else if (c == 'q') b.castling |= CR_BQ;
-            else return false;
+    if (f[2] != "-") {
+        for (const char& c : f[2]) {
+            if      (c == 'K') out.castling |= CR_WK;
+            else if (c == 'Q') out.castling |= CR_WQ;
+            else if (c == 'k') out.castling |= CR_BK;
+            else if (c == 'q') out.castling |= CR_BQ;
+            else return failAt(FEN_BAD_CASTLING, text, &c);
         }
     }
 
     // 4) En passant target square (bitboard). FEN may give '-' or like "e3".
-    b.epTarget = 0ULL;
+    const std::string_view ep = f[3];
     if (ep != "-") {
-        if (ep.size() != 2) return false;
-        char f = ep[0], r = ep[1];
-        if (f < 'a' || f > 'h' || r < '1' || r > '8') return false;
-        int file = f - 'a';
-        int rank = r - '1';
-        int epsq = rank * 8 + file;
-        b.epTarget = BB(epsq);
+        if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] < '1' || ep[1] > '8') {
+            return failAt(FEN_BAD_EP, text, ep.data());
+        }
+        out.epTarget = BB((ep[1] - '1') * 8 + (ep[0] - 'a'));
     }
+    return {};
+}
 
-    // 5) Fifty-move halfmove clock, and 6) fullmove number
-    if (half < 0 || full <= 0) return false;
+// a good position into b, as a new game
+static void setFields(Board& b, const FenFields& f, int half, int full) {
+    for (int c = 0; c < COLOR_N; ++c)
+        for (int p = 0; p < PIECE_N; ++p)
+            b.bb[c][p] = f.bb[c][p];
+    b.sideToMove = f.sideToMove;
+    b.castling = f.castling;
+    b.epTarget = f.epTarget;
     b.halfmoveClock = half;
     b.fullmoveNumber = full;
+    b.st = nullptr; // a new game: no history
+    b.historyPlies = 0;
 
-    // Recompute occupancies
+    // Recompute occupancies, mailbox and the Zobrist key from scratch
     b.recompute();
-    return true;
 }
 
-static inline char pieceChar(const Board& b, int sq) {
-    const U64 m = BB(sq);
-    if      (b.bb[WHITE][PAWN]   & m) return 'P';
-    else if (b.bb[WHITE][KNIGHT] & m) return 'N';
-    else if (b.bb[WHITE][BISHOP] & m) return 'B';
-    else if (b.bb[WHITE][ROOK]   & m) return 'R';
-    else if (b.bb[WHITE][QUEEN]  & m) return 'Q';
-    else if (b.bb[WHITE][KING]   & m) return 'K';
-    else if (b.bb[BLACK][PAWN]   & m) return 'p';
-    else if (b.bb[BLACK][KNIGHT] & m) return 'n';
-    else if (b.bb[BLACK][BISHOP] & m) return 'b';
-    else if (b.bb[BLACK][ROOK]   & m) return 'r';
-    else if (b.bb[BLACK][QUEEN]  & m) return 'q';
-    else if (b.bb[BLACK][KING]   & m) return 'k';
-    return 0;
+// 5) Fifty-move halfmove clock, and 6) fullmove number
+static FenResult readClocks(std::string_view text, std::string_view half, std::string_view full,
+                            int& halfOut, int& fullOut) {
+    if (!parseInt(half, halfOut) || halfOut < 0) return failAt(FEN_BAD_HALFMOVE, text, half.data());
+    if (!parseInt(full, fullOut) || fullOut <= 0) return failAt(FEN_BAD_FULLMOVE, text, full.data());
+    return {};
 }
 
-std::string toFEN(const Board& b) {
-    std::ostringstream out;
+const char* fenErrorText(FenError e) {
+    switch (e) {
+    case FEN_OK:             return "ok";
+    case FEN_MISSING_FIELD:  return "missing field";
+    case FEN_BAD_PIECE:      return "bad piece character";
+    case FEN_BAD_RANK:       return "rank not of 8 squares";
+    case FEN_BAD_RANK_COUNT: return "not 8 ranks";
+    case FEN_BAD_SIDE:       return "bad side to move";
+    case FEN_BAD_CASTLING:   return "bad castling field";
+    case FEN_BAD_EP:         return "bad en passant square";
+    case FEN_BAD_HALFMOVE:   return "bad halfmove clock";
+    case FEN_BAD_FULLMOVE:   return "bad fullmove number";
+    }
+    return "unknown error";
+}
 
-    // 1) Board
+FenResult parseFEN(Board& b, std::string_view fen) {
+    std::string_view f[6];
+    std::string_view rest = fen;
+    for (std::string_view& field : f) {
+        field = nextField(rest);
+        if (field.empty()) return { FEN_MISSING_FIELD, fen.size() };
+    }
+    FenFields fields;
+    int half = 0, full = 1;
+    FenResult r = readFields(fen, f, fields);
+    if (r) r = readClocks(fen, f[4], f[5], half, full);
+    if (r) setFields(b, fields, half, full);
+    return r;
+}
+
+FenResult parseEPD(Board& b, std::string_view line, std::string_view* operations) {
+    std::string_view f[4];
+    std::string_view rest = line;
+    for (std::string_view& field : f) {
+        field = nextField(rest);
+        if (field.empty()) return { FEN_MISSING_FIELD, line.size() };
+    }
+    FenFields fields;
+    int half = 0, full = 1;
+    FenResult r = readFields(line, f, fields);
+    if (!r) return r;
+
+    // FEN clocks, if the next two fields are numbers
+    std::string_view afterClocks = rest;
+    const std::string_view h = nextField(afterClocks), m = nextField(afterClocks);
+    int clock = 0, move = 0;
+    if (parseInt(h, clock) && parseInt(m, move)) {
+        r = readClocks(line, h, m, half, full);
+        if (!r) return r;
+        rest = afterClocks;
+    }
+
+    if (operations) {
+        while (!rest.empty() && isBlank(rest.front())) rest.remove_prefix(1);
+        while (!rest.empty() && isBlank(rest.back())) rest.remove_suffix(1);
+        *operations = rest;
+    }
+    setFields(b, fields, half, full);
+    return r;
+}
+
+bool setFromFEN(Board& b, std::string_view fen) {
+    return static_cast<bool>(parseFEN(b, fen));
+}
+
+bool setFromEPD(Board& b, std::string_view line, std::string_view* operations) {
+    return static_cast<bool>(parseEPD(b, line, operations));
+}
+
+std::size_t writeFEN(const Board& b, char* out) {
+    static constexpr char PIECE_CHARS[COLOR_N][PIECE_N] = { { 'P', 'N', 'B', 'R', 'Q', 'K' },
+                                                            { 'p', 'n', 'b', 'r', 'q', 'k' } };
+    char* p = out;
+
+    // 1) Board: only the occupied squares of each rank are visited, the gaps between them
+    // are the empty runs
     for (int r = 7; r >= 0; --r) {
-        int run = 0;
-        for (int f = 0; f < 8; ++f) {
-            int sq = r * 8 + f;
-            char ch = pieceChar(b, sq);
-            if (ch) {
-                if (run) { out << run; run = 0; }
-                out << ch;
-            } else {
-                ++run;
-            }
+        U64 pieces = (b.occAll >> (r * 8)) & 0xFF;
+        int file = 0;
+        while (pieces) {
+            const int f = std::countr_zero(pieces);
+            pieces &= pieces - 1;
+            if (f > file) *p++ = static_cast<char>('0' + f - file);
+            const int sq = r * 8 + f;
+            *p++ = PIECE_CHARS[(b.occ[BLACK] >> sq) & 1][b.mailbox[sq]];
+            file = f + 1;
         }
-        if (run) out << run;
-        if (r) out << '/';
+        if (file < 8) *p++ = static_cast<char>('0' + 8 - file);
+        if (r) *p++ = '/';
     }
 
     // 2) Side to move
-    out << ' ' << (b.sideToMove == WHITE ? 'w' : 'b') << ' ';
+    *p++ = ' ';
+    *p++ = b.sideToMove == WHITE ? 'w' : 'b';
+    *p++ = ' ';
 
     // 3) Castling
-    std::string cast;
-    if (b.castling & CR_WK) cast += 'K';
-    if (b.castling & CR_WQ) cast += 'Q';
-    if (b.castling & CR_BK) cast += 'k';
-    if (b.castling & CR_BQ) cast += 'q';
-    out << (cast.empty() ? "-" : cast) << ' ';
+    if (b.castling & CR_WK) *p++ = 'K';
+    if (b.castling & CR_WQ) *p++ = 'Q';
+    if (b.castling & CR_BK) *p++ = 'k';
+    if (b.castling & CR_BQ) *p++ = 'q';
+    if (p[-1] == ' ') *p++ = '-';
+    *p++ = ' ';
 
     // 4) En passant
     if (b.epTarget == 0ULL) {
-        out << '-';
+        *p++ = '-';
     } else {
-        int epsq = static_cast<int>(getSquare(b.epTarget));
-        char file = static_cast<char>('a' + (epsq % 8));
-        char rank = static_cast<char>('1' + (epsq / 8));
-        out << file << rank;
+        const int epsq = static_cast<int>(getSquare(b.epTarget));
+        *p++ = static_cast<char>('a' + (epsq % 8));
+        *p++ = static_cast<char>('1' + (epsq / 8));
     }
 
     // 5) Halfmove clock, 6) fullmove number
-    out << ' ' << b.halfmoveClock << ' ' << b.fullmoveNumber;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 11, b.halfmoveClock).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 11, b.fullmoveNumber).ptr;
+    return static_cast<std::size_t>(p - out);
+}
 
-    return out.str();
+std::size_t writeFEN(const Board& b, std::span<char> out) {
+    if (out.size() >= FEN_MAX_LENGTH) return writeFEN(b, out.data());
+    char buf[FEN_MAX_LENGTH];
+    const std::size_t n = writeFEN(b, buf);
+    if (n > out.size()) return 0;
+    std::memcpy(out.data(), buf, n);
+    return n;
+}
+
+std::string toFEN(const Board& b) {
+    char buf[FEN_MAX_LENGTH];
+    return std::string(buf, writeFEN(b, buf));
 }
 
 } // namespace chess
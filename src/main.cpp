@@ -1,94 +1,92 @@
-#include "chess/board.hpp"
-#include "chess/fen.hpp"
-#include "chess/debug.hpp"
-#include "chess/move.hpp"
-#include "chess/defs.hpp"
+#include "chess/batch.hpp"
+#include "chess/bench.hpp"
+#include "chess/search.hpp"
+#include "chess/uci.hpp"
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <sstream>
-#include <vector>
-#include <string>
 
 using namespace chess;
 
-static std::string sqToStr(int sq) {
-    std::string s;
-    s.push_back(static_cast<char>('a' + (sq % 8)));
-    s.push_back(static_cast<char>('1' + (sq / 8)));
-    return s;
-}
-
-static void printMove(const Move& m) {
-    std::cout << sqToStr(m.from) << sqToStr(m.to);
-
-    // flags
-    if (has(m.flags, MF_CastleK)) std::cout << " (O-O)";
-    else if (has(m.flags, MF_CastleQ)) std::cout << " (O-O-O)";
-    else {
-        if (has(m.flags, MF_Capture)) std::cout << " x";
-        if (has(m.flags, MF_EnPassant)) std::cout << " e.p.";
-        if (has(m.flags, MF_PromoQ)) std::cout << " =Q";
-        else if (has(m.flags, MF_PromoR)) std::cout << " =R";
-        else if (has(m.flags, MF_PromoB)) std::cout << " =B";
-        else if (has(m.flags, MF_PromoN)) std::cout << " =N";
+// bench [depth] [--no-nmp] [--no-lmr] [--no-rfp] [--no-lmp] [--no-asp] [--no-cycle]
+static int runBench(int argc, char** argv) {
+    int depth = 10;
+    SearchOptions opts;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--no-nmp")) opts.nullMove = false;
+        else if (!std::strcmp(argv[i], "--no-lmr")) opts.lmr = false;
+        else if (!std::strcmp(argv[i], "--no-rfp")) opts.reverseFutility = false;
+        else if (!std::strcmp(argv[i], "--no-lmp")) opts.lateMovePruning = false;
+        else if (!std::strcmp(argv[i], "--no-asp")) opts.aspiration = false;
+        else if (!std::strcmp(argv[i], "--no-cycle")) opts.upcomingRepetition = false;
+        else if (std::atoi(argv[i]) > 0) depth = std::atoi(argv[i]);
+        else {
+            std::cerr << "unknown bench argument: " << argv[i] << "\n";
+            return 1;
+        }
     }
+    bench(depth, opts, std::cout);
+    return 0;
 }
 
-int main(int argc, char** argv) {
-    // Get FEN (argv or stdin; empty = startpos)
-    std::string fen;
-    if (argc > 1) {
-        std::ostringstream oss;
-        for (int i = 1; i < argc; ++i) {
-            if (i > 1) oss << ' ';
-            oss << argv[i];
+// batch <file> [--perft N | --eval | --depth N | --nodes N] [--threads N] [--hash MB]
+// (legal move counts by default); results on stdout, totals on stderr
+static int runBatchFile(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: chess batch <file> [--perft N | --eval | --depth N | --nodes N] [--threads N] [--hash MB]\n";
+        return 1;
+    }
+    BatchOptions opts;
+    int searchDepth = 0;
+    std::uint64_t searchNodes = 0;
+    for (int i = 3; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--perft") && hasValue) {
+            opts.job = JOB_PERFT;
+            opts.depth = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--eval")) {
+            opts.job = JOB_EVAL;
+        } else if (!std::strcmp(argv[i], "--depth") && hasValue) {
+            searchDepth = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--nodes") && hasValue) {
+            searchNodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "--threads") && hasValue) {
+            opts.threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--hash") && hasValue) {
+            opts.hashMb = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "unknown batch argument: " << argv[i] << "\n";
+            return 1;
         }
-        fen = oss.str();
-    } else {
-        std::cout << "Enter FEN (empty = startpos):\n> ";
-        std::getline(std::cin, fen);
     }
-    if (fen.empty()) fen = std::string(STARTPOS_FEN);
-
-    // Build board from FEN
-    Board b;
-    if (!setFromFEN(b, fen)) {
-        std::cerr << "Invalid FEN.\n";
-        return 1;
+    if (searchDepth > 0 || searchNodes > 0) {
+        opts.job = JOB_SEARCH;
+        opts.depth = searchDepth;
+        opts.nodes = searchNodes;
     }
 
-    std::cout << "\nInitial position:\n";
-    printBoard(b);
-
-    const Color us   = b.sideToMove;
-    const Color them = other(us);
-
-    if (b.state() != PLAYING) {
-        std::cout << "Game over: ";
-        if (b.state() == CHECKMATE){
-            std::cout << "Checkmate, " << (them == WHITE ? "White" : "Black") << " wins.\n";
-        } else if (b.state() == STALEMATE) {
-            std::cout << "Stalemate, draw.\n";
-        } 
-        return 0;
+    std::ios::sync_with_stdio(false);
+    BatchStats stats;
+    std::string error;
+    if (!runBatch(argv[2], opts, std::cout, &stats, &error)) {
+        std::cerr << "batch: " << error << "\n";
+        return 1;
     }
+    std::cout.flush();
+    std::cerr << "positions " << stats.positions << "  invalid " << stats.invalid << "  nodes " << stats.nodes
+              << "  time " << stats.ms << " ms  positions/s "
+              << (stats.ms > 0 ? stats.positions * 1000 / static_cast<std::uint64_t>(stats.ms) : 0) << "\n";
+    return 0;
+}
 
-    std::vector<Move> legal;
-    legal = b.generateLegalMoves();
-
-    std::cout << "Side to move: " << (us == WHITE ? "White" : "Black") << "\n";
-
-
-    // Print all legal moves and resulting boards
-    int idx = 1;
-    for (const Move& m : legal) {
-        std::cout << "#" << idx++ << " ";
-        printMove(m);
-        std::cout << "\n";
-
-        Board child = b.applied(m);
-        printBoard(child);
-    }
+// UCI engine on stdin/stdout; "chess bench ..." runs the bench, "chess batch ..." a
+// position file instead
+int main(int argc, char** argv) {
+    if (argc > 1 && !std::strcmp(argv[1], "bench")) return runBench(argc, argv);
+    if (argc > 1 && !std::strcmp(argv[1], "batch")) return runBatchFile(argc, argv);
 
+    Uci uci(std::cout);
+    uci.loop(std::cin);
     return 0;
-}
\ No newline at end of file
+}
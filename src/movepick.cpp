@@ -0,0 +1,178 @@
+#include "chess/movepick.hpp"
+#include "chess/eval.hpp"
+#include "chess/see.hpp"
+#include "chess/tt.hpp"
+
+#include <utility>
+
+namespace chess {
+
+// quiet move scores above any history value
+static constexpr int KILLER_SCORE = 1 << 20;
+
+MovePicker::MovePicker(const Board& b, U16 tt, const Move* killers, const Move& counter,
+                       const int (*history)[64], const int (*contHist)[64])
+    : b(b), stage(TT_MOVE), killers(killers), counter(counter), history(history), contHist(contHist) {
+    // a hash move may come from another position with the same key (or a damaged
+    // entry): only trust it if the piece on its from square can really play it
+    if (tt) {
+        b.generateLegalMoves(moves, GEN_ALL, BB(tt & 63));
+        for (const Move& m : moves) {
+            if (packMove(m) == tt) {
+                ttMove = m;
+                hasTTMove = true;
+                break;
+            }
+        }
+        moves.clear();
+    }
+}
+
+MovePicker::MovePicker(const Board& b, bool inCheck)
+    : b(b), stage(QS_CAPTURES_INIT), inCheck(inCheck) {}
+
+// most valuable victim first, least valuable attacker among equals; promotions count
+// the piece they make
+void MovePicker::scoreCaptures() {
+    for (int i = cur; i < end; ++i) {
+        const Move& m = moves[i];
+        const Piece victim = has(m.flags(), MF_EnPassant) ? PAWN : b.pieceOn(m.to());
+        int value = victim == PIECE_N ? 0 : PIECE_VALUE[victim];
+        if (has(m.flags(), MF_PromoMask)) value += PIECE_VALUE[promoPiece(m.flags())];
+        scores[i] = value * 8 - static_cast<int>(b.pieceOn(m.from()));
+    }
+}
+
+void MovePicker::scoreQuiets() {
+    for (int i = cur; i < end; ++i) {
+        const Move& m = moves[i];
+        if (killers && m == killers[0]) {
+            scores[i] = KILLER_SCORE + 2;
+        } else if (killers && m == killers[1]) {
+            scores[i] = KILLER_SCORE + 1;
+        } else if (m == counter) {
+            scores[i] = KILLER_SCORE;
+        } else {
+            scores[i] = (history ? history[m.from()][m.to()] : 0) + (contHist ? contHist[b.pieceOn(m.from())][m.to()] : 0);
+        }
+    }
+}
+
+void MovePicker::selectBest() {
+    int best = cur;
+    for (int i = cur + 1; i < end; ++i)
+        if (scores[i] > scores[best]) best = i;
+    std::swap(moves[cur], moves[best]);
+    std::swap(scores[cur], scores[best]);
+}
+
+bool MovePicker::next(Move& m) {
+    switch (stage) {
+    case TT_MOVE:
+        stage = CAPTURES_INIT;
+        if (hasTTMove) {
+            m = ttMove;
+            return true;
+        }
+        [[fallthrough]];
+
+    case CAPTURES_INIT:
+        b.generateLegalMoves(moves, GEN_CAPTURES);
+        cur = badEnd = 0;
+        end = moves.size();
+        scoreCaptures();
+        stage = GOOD_CAPTURES;
+        [[fallthrough]];
+
+    case GOOD_CAPTURES:
+        while (cur < end) {
+            selectBest();
+            const Move mv = moves[cur++];
+            if (hasTTMove && mv == ttMove) continue;
+            // losing captures wait until the quiet moves are done (the slot is already used)
+            if (!seeGE(b, mv, 0)) {
+                moves[badEnd++] = mv;
+                continue;
+            }
+            m = mv;
+            return true;
+        }
+        stage = QUIETS_INIT;
+        [[fallthrough]];
+
+    case QUIETS_INIT:
+        cur = end;
+        if (skipQuietMoves) {
+            cur = 0;
+            stage = BAD_CAPTURES;
+            return next(m);
+        }
+        b.generateLegalMoves(moves, GEN_QUIETS);
+        end = moves.size();
+        scoreQuiets();
+        stage = QUIETS;
+        [[fallthrough]];
+
+    case QUIETS:
+        while (cur < end && !skipQuietMoves) {
+            selectBest();
+            const Move mv = moves[cur++];
+            if (hasTTMove && mv == ttMove) continue;
+            m = mv;
+            return true;
+        }
+        cur = 0;
+        stage = BAD_CAPTURES;
+        [[fallthrough]];
+
+    case BAD_CAPTURES:
+        // already in MVV-LVA order, the order they were parked in
+        if (cur < badEnd) {
+            m = moves[cur++];
+            return true;
+        }
+        stage = DONE;
+        return false;
+
+    case QS_CAPTURES_INIT:
+        b.generateLegalMoves(moves, GEN_CAPTURES);
+        cur = 0;
+        end = moves.size();
+        scoreCaptures();
+        stage = QS_CAPTURES;
+        [[fallthrough]];
+
+    case QS_CAPTURES:
+        if (cur < end) {
+            selectBest();
+            m = moves[cur++];
+            return true;
+        }
+        if (!inCheck) {
+            stage = DONE;
+            return false;
+        }
+        stage = QS_EVASIONS_INIT;
+        [[fallthrough]];
+
+    case QS_EVASIONS_INIT:
+        b.generateLegalMoves(moves, GEN_QUIETS);
+        end = moves.size();
+        stage = QS_EVASIONS;
+        [[fallthrough]];
+
+    case QS_EVASIONS:
+        if (cur < end) {
+            m = moves[cur++];
+            return true;
+        }
+        stage = DONE;
+        return false;
+
+    case DONE:
+        break;
+    }
+    return false;
+}
+
+} // namespace chess
@@ -0,0 +1,576 @@
+#include "chess/nnue.hpp"
+#include "chess/board.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHESS_NNUE_X86 1
+#endif
+
+namespace chess {
+
+// ---- kernels ---------------------------------------------------------------
+
+static void updateScalar(std::int16_t* out, const std::int16_t* in, const std::int16_t* const* added, int nAdded,
+                         const std::int16_t* const* removed, int nRemoved) {
+    for (int i = 0; i < NNUE_L1; ++i) {
+        int v = in[i];
+        for (int a = 0; a < nAdded; ++a) v += added[a][i];
+        for (int r = 0; r < nRemoved; ++r) v -= removed[r][i];
+        out[i] = static_cast<std::int16_t>(v);
+    }
+}
+
+static void clampPackScalar(const std::int16_t* acc, std::uint8_t* out) {
+    for (int i = 0; i < NNUE_L1; ++i) out[i] = static_cast<std::uint8_t>(std::clamp<int>(acc[i], 0, 127));
+}
+
+static void affineScalar(const std::uint8_t* in, int n, const std::int8_t* weights,
+                         const std::int32_t* bias, std::int32_t* out, int outputs) {
+    for (int j = 0; j < outputs; ++j) {
+        std::int32_t sum = bias[j];
+        const std::int8_t* row = weights + j * n;
+        for (int i = 0; i < n; ++i) sum += in[i] * row[i];
+        out[j] = sum;
+    }
+}
+
+static void clampHiddenScalar(const std::int32_t* in, std::uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) out[i] = static_cast<std::uint8_t>(std::clamp(in[i] >> NNUE_HIDDEN_SHIFT, 0, 127));
+}
+
+static const NnueKernels SCALAR_KERNELS = { "scalar", updateScalar, clampPackScalar, affineScalar, clampHiddenScalar };
+
+#ifdef CHESS_NNUE_X86
+
+// inputs are at most 127, so the pairwise uint8 x int8 sums of maddubs never saturate
+// and every kernel gives exactly the scalar result
+
+// the whole accumulator stays in registers (8 of the 16) while the columns go by
+__attribute__((target("sse4.1")))
+static void updateSse41(std::int16_t* out, const std::int16_t* in, const std::int16_t* const* added, int nAdded,
+                        const std::int16_t* const* removed, int nRemoved) {
+    constexpr int R = NNUE_L1 / 8;
+    __m128i v[R];
+#pragma GCC unroll 8
+    for (int i = 0; i < R; ++i) v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in) + i);
+    for (int a = 0; a < nAdded; ++a)
+#pragma GCC unroll 8
+        for (int i = 0; i < R; ++i) v[i] = _mm_add_epi16(v[i], _mm_loadu_si128(reinterpret_cast<const __m128i*>(added[a]) + i));
+    for (int r = 0; r < nRemoved; ++r)
+#pragma GCC unroll 8
+        for (int i = 0; i < R; ++i) v[i] = _mm_sub_epi16(v[i], _mm_loadu_si128(reinterpret_cast<const __m128i*>(removed[r]) + i));
+#pragma GCC unroll 8
+    for (int i = 0; i < R; ++i) _mm_storeu_si128(reinterpret_cast<__m128i*>(out) + i, v[i]);
+}
+
+__attribute__((target("sse4.1")))
+static void clampPackSse41(const std::int16_t* acc, std::uint8_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < NNUE_L1; i += 16) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i + 8));
+        // saturate to -128..127, then drop the negatives
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_max_epi8(_mm_packs_epi16(lo, hi), zero));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void clampHiddenSse41(const std::int32_t* in, std::uint8_t* out, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < n; i += 16) {
+        const __m128i* p = reinterpret_cast<const __m128i*>(in + i);
+        // shift, saturate down to int16 then int8, drop the negatives
+        const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(_mm_loadu_si128(p), NNUE_HIDDEN_SHIFT),
+                                           _mm_srai_epi32(_mm_loadu_si128(p + 1), NNUE_HIDDEN_SHIFT));
+        const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(_mm_loadu_si128(p + 2), NNUE_HIDDEN_SHIFT),
+                                           _mm_srai_epi32(_mm_loadu_si128(p + 3), NNUE_HIDDEN_SHIFT));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_max_epi8(_mm_packs_epi16(lo, hi), zero));
+    }
+}
+
+// 16 uint8 inputs times 16 int8 weights, summed into 4 int32 lanes
+__attribute__((target("sse4.1")))
+static inline __m128i dotSse41(const std::int8_t* row, int i, __m128i x, __m128i ones) {
+    return _mm_madd_epi16(_mm_maddubs_epi16(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i))), ones);
+}
+
+__attribute__((target("sse4.1")))
+static void affineSse41(const std::uint8_t* in, int n, const std::int8_t* weights,
+                        const std::int32_t* bias, std::int32_t* out, int outputs) {
+    const __m128i ones = _mm_set1_epi16(1);
+    int j = 0;
+    // four rows at a time: every input chunk is loaded once, one horizontal add for all four
+    for (; j + 4 <= outputs; j += 4) {
+        const std::int8_t* row = weights + j * n;
+        __m128i s0 = _mm_setzero_si128(), s1 = s0, s2 = s0, s3 = s0;
+        for (int i = 0; i < n; i += 16) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            s0 = _mm_add_epi32(s0, dotSse41(row, i, x, ones));
+            s1 = _mm_add_epi32(s1, dotSse41(row + n, i, x, ones));
+            s2 = _mm_add_epi32(s2, dotSse41(row + 2 * n, i, x, ones));
+            s3 = _mm_add_epi32(s3, dotSse41(row + 3 * n, i, x, ones));
+        }
+        const __m128i sums = _mm_hadd_epi32(_mm_hadd_epi32(s0, s1), _mm_hadd_epi32(s2, s3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j),
+                         _mm_add_epi32(sums, _mm_loadu_si128(reinterpret_cast<const __m128i*>(bias + j))));
+    }
+    for (; j < outputs; ++j) {
+        const std::int8_t* row = weights + j * n;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < n; i += 16) {
+            sum = _mm_add_epi32(sum, dotSse41(row, i, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), ones));
+        }
+        sum = _mm_hadd_epi32(sum, sum);
+        sum = _mm_hadd_epi32(sum, sum);
+        out[j] = bias[j] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+__attribute__((target("avx2")))
+static void updateAvx2(std::int16_t* out, const std::int16_t* in, const std::int16_t* const* added, int nAdded,
+                       const std::int16_t* const* removed, int nRemoved) {
+    constexpr int R = NNUE_L1 / 16;
+    __m256i v[R];
+#pragma GCC unroll 8
+    for (int i = 0; i < R; ++i) v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in) + i);
+    for (int a = 0; a < nAdded; ++a)
+#pragma GCC unroll 8
+        for (int i = 0; i < R; ++i) v[i] = _mm256_add_epi16(v[i], _mm256_loadu_si256(reinterpret_cast<const __m256i*>(added[a]) + i));
+    for (int r = 0; r < nRemoved; ++r)
+#pragma GCC unroll 8
+        for (int i = 0; i < R; ++i) v[i] = _mm256_sub_epi16(v[i], _mm256_loadu_si256(reinterpret_cast<const __m256i*>(removed[r]) + i));
+#pragma GCC unroll 8
+    for (int i = 0; i < R; ++i) _mm256_storeu_si256(reinterpret_cast<__m256i*>(out) + i, v[i]);
+}
+
+__attribute__((target("avx2")))
+static void clampPackAvx2(const std::int16_t* acc, std::uint8_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < NNUE_L1; i += 32) {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i + 16));
+        // packs works per 128-bit lane; the permute puts the 64-bit groups back in order
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_max_epi8(packed, zero));
+    }
+}
+
+// 32 uint8 inputs times 32 int8 weights, summed into 8 int32 lanes
+__attribute__((target("avx2")))
+static inline __m256i dotAvx2(const std::int8_t* row, int i, __m256i x, __m256i ones) {
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i))), ones);
+}
+
+// lane r of the result is the sum of the eight lanes of sr
+__attribute__((target("avx2")))
+static inline __m256i hsum8Avx2(__m256i s0, __m256i s1, __m256i s2, __m256i s3,
+                                 __m256i s4, __m256i s5, __m256i s6, __m256i s7) {
+    // each 128-bit half: partial sums of s0..s3 (s4..s7), low and high halves apart
+    const __m256i s0123 = _mm256_hadd_epi32(_mm256_hadd_epi32(s0, s1), _mm256_hadd_epi32(s2, s3));
+    const __m256i s4567 = _mm256_hadd_epi32(_mm256_hadd_epi32(s4, s5), _mm256_hadd_epi32(s6, s7));
+    return _mm256_add_epi32(_mm256_permute2x128_si256(s0123, s4567, 0x20),
+                            _mm256_permute2x128_si256(s0123, s4567, 0x31));
+}
+
+__attribute__((target("avx2")))
+static void affineAvx2(const std::uint8_t* in, int n, const std::int8_t* weights,
+                       const std::int32_t* bias, std::int32_t* out, int outputs) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    int j = 0;
+    if (n == 16) {
+        // 16-wide layer: two rows per register against the input in both halves
+        const __m256i x = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; j + 8 <= outputs; j += 8) {
+            const std::int8_t* row = weights + j * n;
+            const __m256i d01 = _mm256_hadd_epi32(dotAvx2(row, 0, x, ones), dotAvx2(row, 32, x, ones));
+            const __m256i d23 = _mm256_hadd_epi32(dotAvx2(row, 64, x, ones), dotAvx2(row, 96, x, ones));
+            // halves hold rows 0,2,4,6 and 1,3,5,7
+            const __m256i sums = _mm256_permutevar8x32_epi32(_mm256_hadd_epi32(d01, d23), order);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j),
+                                _mm256_add_epi32(sums, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bias + j))));
+        }
+        if (j < outputs) affineSse41(in, n, weights + j * n, bias + j, out + j, outputs - j);
+        return;
+    }
+    // eight rows at a time: eight independent sums keep the multipliers busy, and one
+    // horizontal add tree gives all eight outputs
+    for (; j + 8 <= outputs; j += 8) {
+        const std::int8_t* row = weights + j * n;
+        __m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0, s4 = s0, s5 = s0, s6 = s0, s7 = s0;
+        for (int i = 0; i < n; i += 32) {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            s0 = _mm256_add_epi32(s0, dotAvx2(row, i, x, ones));
+            s1 = _mm256_add_epi32(s1, dotAvx2(row + n, i, x, ones));
+            s2 = _mm256_add_epi32(s2, dotAvx2(row + 2 * n, i, x, ones));
+            s3 = _mm256_add_epi32(s3, dotAvx2(row + 3 * n, i, x, ones));
+            s4 = _mm256_add_epi32(s4, dotAvx2(row + 4 * n, i, x, ones));
+            s5 = _mm256_add_epi32(s5, dotAvx2(row + 5 * n, i, x, ones));
+            s6 = _mm256_add_epi32(s6, dotAvx2(row + 6 * n, i, x, ones));
+            s7 = _mm256_add_epi32(s7, dotAvx2(row + 7 * n, i, x, ones));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j),
+                            _mm256_add_epi32(hsum8Avx2(s0, s1, s2, s3, s4, s5, s6, s7),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bias + j))));
+    }
+    // four rows at a time: every input chunk is loaded once, one horizontal add for all four
+    for (; j + 4 <= outputs; j += 4) {
+        const std::int8_t* row = weights + j * n;
+        __m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+        for (int i = 0; i < n; i += 32) {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            s0 = _mm256_add_epi32(s0, dotAvx2(row, i, x, ones));
+            s1 = _mm256_add_epi32(s1, dotAvx2(row + n, i, x, ones));
+            s2 = _mm256_add_epi32(s2, dotAvx2(row + 2 * n, i, x, ones));
+            s3 = _mm256_add_epi32(s3, dotAvx2(row + 3 * n, i, x, ones));
+        }
+        const __m256i sums = _mm256_hadd_epi32(_mm256_hadd_epi32(s0, s1), _mm256_hadd_epi32(s2, s3));
+        const __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j),
+                         _mm_add_epi32(total, _mm_loadu_si128(reinterpret_cast<const __m128i*>(bias + j))));
+    }
+    for (; j < outputs; ++j) {
+        const std::int8_t* row = weights + j * n;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < n; i += 32) {
+            sum = _mm256_add_epi32(sum, dotAvx2(row, i, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_hadd_epi32(s, s);
+        s = _mm_hadd_epi32(s, s);
+        out[j] = bias[j] + _mm_cvtsi128_si32(s);
+    }
+}
+
+// AVX-VNNI: vpdpbusd does maddubs, madd and the add in one instruction, without the
+// intermediate int16 saturation (which never happens here anyway, see above)
+__attribute__((target("avx2,avxvnni")))
+static inline __m256i dotVnni(__m256i sum, const std::int8_t* row, int i, __m256i x) {
+    return _mm256_dpbusd_avx_epi32(sum, x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+}
+
+__attribute__((target("avx2,avxvnni")))
+static void affineVnni(const std::uint8_t* in, int n, const std::int8_t* weights,
+                       const std::int32_t* bias, std::int32_t* out, int outputs) {
+    const __m256i zero = _mm256_setzero_si256();
+    int j = 0;
+    if (n == 16) {
+        // same layout as affineAvx2: two rows per register against the input in both halves
+        const __m256i x = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; j + 8 <= outputs; j += 8) {
+            const std::int8_t* row = weights + j * n;
+            const __m256i d01 = _mm256_hadd_epi32(dotVnni(zero, row, 0, x), dotVnni(zero, row, 32, x));
+            const __m256i d23 = _mm256_hadd_epi32(dotVnni(zero, row, 64, x), dotVnni(zero, row, 96, x));
+            const __m256i sums = _mm256_permutevar8x32_epi32(_mm256_hadd_epi32(d01, d23), order);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j),
+                                _mm256_add_epi32(sums, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bias + j))));
+        }
+        if (j < outputs) affineSse41(in, n, weights + j * n, bias + j, out + j, outputs - j);
+        return;
+    }
+    for (; j + 8 <= outputs; j += 8) {
+        const std::int8_t* row = weights + j * n;
+        __m256i s0 = zero, s1 = zero, s2 = zero, s3 = zero, s4 = zero, s5 = zero, s6 = zero, s7 = zero;
+        for (int i = 0; i < n; i += 32) {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            s0 = dotVnni(s0, row, i, x);
+            s1 = dotVnni(s1, row + n, i, x);
+            s2 = dotVnni(s2, row + 2 * n, i, x);
+            s3 = dotVnni(s3, row + 3 * n, i, x);
+            s4 = dotVnni(s4, row + 4 * n, i, x);
+            s5 = dotVnni(s5, row + 5 * n, i, x);
+            s6 = dotVnni(s6, row + 6 * n, i, x);
+            s7 = dotVnni(s7, row + 7 * n, i, x);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j),
+                            _mm256_add_epi32(hsum8Avx2(s0, s1, s2, s3, s4, s5, s6, s7),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bias + j))));
+    }
+    if (j < outputs) affineAvx2(in, n, weights + j * n, bias + j, out + j, outputs - j);
+}
+
+// the hidden layers are at most 32 wide: the sse4.1 clamp is as fast as an avx2 one would be
+static const NnueKernels SSE41_KERNELS = { "sse41",   updateSse41, clampPackSse41, affineSse41, clampHiddenSse41 };
+static const NnueKernels AVX2_KERNELS  = { "avx2",    updateAvx2,  clampPackAvx2,  affineAvx2,  clampHiddenSse41 };
+// the accumulator kernels have nothing for VNNI to speed up
+static const NnueKernels VNNI_KERNELS  = { "avxvnni", updateAvx2,  clampPackAvx2,  affineVnni,  clampHiddenSse41 };
+
+#endif // CHESS_NNUE_X86
+
+const NnueKernels* nnueKernels(const std::string& name) {
+    if (name == "scalar") return &SCALAR_KERNELS;
+#ifdef CHESS_NNUE_X86
+    __builtin_cpu_init();
+    if (name == "sse41" && __builtin_cpu_supports("sse4.1")) return &SSE41_KERNELS;
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) return &AVX2_KERNELS;
+    if (name == "avxvnni" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avxvnni")) return &VNNI_KERNELS;
+#endif
+    return nullptr;
+}
+
+// best supported set, or the best one at or below CHESS_SIMD
+static const NnueKernels* selectKernels() {
+    const char* forced = std::getenv("CHESS_SIMD");
+    bool allowed = forced == nullptr;
+    for (const char* name : { "avxvnni", "avx2", "sse41", "scalar" }) {
+        if (!allowed && std::strcmp(name, forced) != 0) continue;
+        allowed = true;
+        if (const NnueKernels* k = nnueKernels(name)) return k;
+    }
+    return &SCALAR_KERNELS;
+}
+
+const NnueKernels* NNUE_KERNELS = selectKernels();
+const NnueNetwork* NNUE_NET = nullptr;
+
+// ---- accumulator -----------------------------------------------------------
+
+static int relative(Color perspective, int sq) {
+    return perspective == WHITE ? sq : sq ^ 56;
+}
+
+// 4 buckets: king on the queen or king side, on its first two ranks or further up
+static int kingBucket(Color perspective, int kingSq) {
+    const int rel = relative(perspective, kingSq);
+    return (rel % 8 >= 4 ? 1 : 0) + (rel / 8 >= 2 ? 2 : 0);
+}
+
+static int kingSquare(const Board& b, Color c) {
+    return b.bb[c][KING] ? getSquare(b.bb[c][KING]) : 0;
+}
+
+// weight columns of perspective's current king bucket, indexed by feature within the bucket
+static const std::int16_t* bucketColumns(const Board& b, Color perspective) {
+    const int bucket = kingBucket(perspective, kingSquare(b, perspective));
+    return b.accNet->ftWeights + bucket * 2 * PIECE_N * 64 * NNUE_L1;
+}
+
+static const std::int16_t* column(const std::int16_t* columns, Color perspective, Color c, Piece p, int sq) {
+    const int side = c == perspective ? 0 : 1;
+    return columns + ((side * PIECE_N + p) * 64 + relative(perspective, sq)) * NNUE_L1;
+}
+
+// bias plus the columns of every piece on the board, in one pass
+static void refreshInto(const Board& b, Color perspective, std::int16_t* out) {
+    const std::int16_t* columns = bucketColumns(b, perspective);
+    const std::int16_t* active[64];
+    int n = 0;
+    for (int c = 0; c < COLOR_N; ++c)
+        for (int p = 0; p < PIECE_N; ++p)
+            for (U64 pieces = b.bb[c][p]; pieces; pieces &= pieces - 1)
+                active[n++] = column(columns, perspective, static_cast<Color>(c), static_cast<Piece>(p), getSquare(pieces));
+    NNUE_KERNELS->update(out, b.accNet->ftBias, active, n, nullptr, 0);
+}
+
+void nnueRefresh(Board& b, Color perspective) {
+    refreshInto(b, perspective, b.acc[perspective]);
+}
+
+// called after the bitboards changed. A piece taken off where the same move put it (a
+// promoting pawn) cancels out; a king placed or removed moves every feature of its side.
+void nnuePut(Board& b, Color c, Piece p, int sq) {
+    NnueDirty& d = b.st->dirty;
+    if (p == KING) d.refresh[c] = true;
+    for (int i = 0; i < d.nRemoved; ++i) {
+        if (d.removed[i].c == c && d.removed[i].p == p && d.removed[i].sq == sq) {
+            d.removed[i] = d.removed[--d.nRemoved];
+            return;
+        }
+    }
+    assert(d.nAdded < 2);
+    d.added[d.nAdded++] = { c, p, sq };
+}
+
+void nnueRemove(Board& b, Color c, Piece p, int sq) {
+    NnueDirty& d = b.st->dirty;
+    if (p == KING) d.refresh[c] = true;
+    for (int i = 0; i < d.nAdded; ++i) {
+        if (d.added[i].c == c && d.added[i].p == p && d.added[i].sq == sq) {
+            d.added[i] = d.added[--d.nAdded];
+            return;
+        }
+    }
+    assert(d.nRemoved < 2);
+    d.removed[d.nRemoved++] = { c, p, sq };
+}
+
+void nnueMove(Board& b, Color c, Piece p, int from, int to) {
+    NnueDirty& d = b.st->dirty;
+    // the king's own side only needs a rebuild when the king changes bucket
+    if (p == KING && kingBucket(c, from) != kingBucket(c, to)) d.refresh[c] = true;
+    assert(d.nAdded < 2 && d.nRemoved < 2);
+    d.removed[d.nRemoved++] = { c, p, from };
+    d.added[d.nAdded++] = { c, p, to };
+}
+
+// Records between b.accRoot and the top of the stack that were never evaluated have no
+// accumulator yet. Walk down to the nearest one that has (or to the board's own) and
+// replay the moves from there, filling in every record on the way: the siblings of a
+// node then start one move away. A king changing bucket on the way, or a long run of
+// unevaluated moves, rebuilds the top one from the pieces instead.
+const std::int16_t* nnueAccumulator(const Board& b, Color perspective) {
+    constexpr int MAX_REPLAY = 16;
+    StateInfo* top = b.st;
+    if (top == b.accRoot) return b.acc[perspective];
+    if (top->accComputed[perspective]) return top->acc[perspective];
+
+    StateInfo* path[MAX_REPLAY];
+    int n = 0;
+    const std::int16_t* from = nullptr;
+    for (StateInfo* s = top; n < MAX_REPLAY && !s->dirty.refresh[perspective]; s = s->prev) {
+        path[n++] = s;
+        assert(s->prev != nullptr || b.accRoot == nullptr); // accRoot is on the stack
+        if (s->prev == b.accRoot) { from = b.acc[perspective]; break; }
+        if (s->prev->accComputed[perspective]) { from = s->prev->acc[perspective]; break; }
+    }
+    if (!from) {
+        refreshInto(b, perspective, top->acc[perspective]);
+        top->accComputed[perspective] = true;
+        return top->acc[perspective];
+    }
+
+    // no king changed bucket on the path: the current bucket is every record's
+    const std::int16_t* columns = bucketColumns(b, perspective);
+    for (int i = n - 1; i >= 0; --i) {
+        StateInfo& s = *path[i];
+        const std::int16_t* added[2];
+        const std::int16_t* removed[2];
+        for (int a = 0; a < s.dirty.nAdded; ++a)
+            added[a] = column(columns, perspective, s.dirty.added[a].c, s.dirty.added[a].p, s.dirty.added[a].sq);
+        for (int r = 0; r < s.dirty.nRemoved; ++r)
+            removed[r] = column(columns, perspective, s.dirty.removed[r].c, s.dirty.removed[r].p, s.dirty.removed[r].sq);
+        NNUE_KERNELS->update(s.acc[perspective], from, added, s.dirty.nAdded, removed, s.dirty.nRemoved);
+        s.accComputed[perspective] = true;
+        from = s.acc[perspective];
+    }
+    return top->acc[perspective];
+}
+
+// ---- inference -------------------------------------------------------------
+
+int nnueEvaluate(const Board& b) {
+    const NnueNetwork& net = *b.accNet;
+    const NnueKernels& k = *NNUE_KERNELS;
+    const Color us = b.sideToMove;
+
+    alignas(32) std::uint8_t input[2 * NNUE_L1];
+    k.clampPack(nnueAccumulator(b, us), input);
+    k.clampPack(nnueAccumulator(b, other(us)), input + NNUE_L1);
+
+    alignas(32) std::int32_t sums[std::max(NNUE_L2, NNUE_L3)]; // reused by both hidden layers
+    alignas(32) std::uint8_t hidden1[NNUE_L2];
+    k.affine(input, 2 * NNUE_L1, net.l1Weights, net.l1Bias, sums, NNUE_L2);
+    k.clampHidden(sums, hidden1, NNUE_L2);
+
+    alignas(32) std::uint8_t hidden2[NNUE_L3];
+    k.affine(hidden1, NNUE_L2, net.l2Weights, net.l2Bias, sums, NNUE_L3);
+    k.clampHidden(sums, hidden2, NNUE_L3);
+
+    // a single output: a plain loop the compiler vectorizes beats a kernel call
+    std::int32_t output = net.outBias[0];
+    for (int i = 0; i < NNUE_L3; ++i) output += hidden2[i] * net.outWeights[i];
+    return output / NNUE_OUTPUT_SCALE;
+}
+
+// ---- weights file ----------------------------------------------------------
+
+// a mapped weights file, unmapped at exit
+struct NnueMapping {
+    void* addr = MAP_FAILED;
+    std::size_t size = 0;
+    NnueNetwork net{};
+    ~NnueMapping() { if (addr != MAP_FAILED) munmap(addr, size); }
+};
+
+static std::vector<std::unique_ptr<NnueMapping>>& mappings() {
+    static std::vector<std::unique_ptr<NnueMapping>> m;
+    return m;
+}
+
+static bool fail(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+bool nnueLoad(const std::string& path, std::string* error) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return fail(error, "cannot open " + path);
+
+    struct stat st{};
+    NnueFileHeader h{};
+    const bool readable = ::fstat(fd, &st) == 0
+        && ::pread(fd, &h, sizeof(h), 0) == static_cast<ssize_t>(sizeof(h));
+    if (!readable) {
+        ::close(fd);
+        return fail(error, path + ": too short for a header");
+    }
+    std::string problem;
+    if (std::memcmp(h.magic, NNUE_MAGIC, sizeof(NNUE_MAGIC)) != 0)
+        problem = "not a network file (bad magic)";
+    else if (h.version != NNUE_VERSION)
+        problem = "version " + std::to_string(h.version) + ", expected " + std::to_string(NNUE_VERSION);
+    else if (h.inputs != NNUE_INPUTS || h.l1 != NNUE_L1 || h.l2 != NNUE_L2 || h.l3 != NNUE_L3)
+        problem = "layer sizes do not match this build";
+    else if (static_cast<std::size_t>(st.st_size) != NNUE_FILE_SIZE)
+        problem = "size " + std::to_string(st.st_size) + ", expected " + std::to_string(NNUE_FILE_SIZE);
+    if (!problem.empty()) {
+        ::close(fd);
+        return fail(error, path + ": " + problem);
+    }
+
+    auto m = std::make_unique<NnueMapping>();
+    m->size = NNUE_FILE_SIZE;
+    m->addr = ::mmap(nullptr, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m->addr == MAP_FAILED) return fail(error, path + ": mmap failed");
+
+    // the arrays follow the header back to back; all sizes are multiples of 32 bytes
+    // except the last, so every array stays 32-byte aligned in the page-aligned mapping
+    const char* p = static_cast<const char*>(m->addr) + sizeof(NnueFileHeader);
+    auto take = [&p](auto*& field, std::size_t count) {
+        using T = std::remove_const_t<std::remove_pointer_t<std::remove_reference_t<decltype(field)>>>;
+        field = reinterpret_cast<const T*>(p);
+        p += count * sizeof(T);
+    };
+    NnueNetwork& net = m->net;
+    take(net.ftWeights, static_cast<std::size_t>(NNUE_INPUTS) * NNUE_L1);
+    take(net.ftBias, NNUE_L1);
+    take(net.l1Weights, 2 * NNUE_L1 * NNUE_L2);
+    take(net.l1Bias, NNUE_L2);
+    take(net.l2Weights, NNUE_L2 * NNUE_L3);
+    take(net.l2Bias, NNUE_L3);
+    take(net.outWeights, NNUE_L3);
+    take(net.outBias, 1);
+
+    NNUE_NET = &net;
+    mappings().push_back(std::move(m));
+    return true;
+}
+
+struct NnueInit {
+    NnueInit() {
+        const char* path = std::getenv("CHESS_NNUE");
+        if (!path) return;
+        std::string error;
+        if (!nnueLoad(path, &error)) std::cerr << "CHESS_NNUE: " << error << "\n";
+    }
+};
+
+static NnueInit nnueInit;
+
+} // namespace chess
@@ -1,15 +1,18 @@
 #include "chess/perft.hpp"
 #include "chess/board.hpp"
+#include "chess/thread_pool.hpp"
 
+#include <array>
 #include <string>
+#include <vector>
 
 namespace chess {
 
 static char promoChar(const Move& m) {
-    if (has(m.flags, MF_PromoQ)) return 'q';
-    if (has(m.flags, MF_PromoR)) return 'r';
-    if (has(m.flags, MF_PromoB)) return 'b';
-    if (has(m.flags, MF_PromoN)) return 'n';
+    if (has(m.flags(), MF_PromoQ)) return 'q';
+    if (has(m.flags(), MF_PromoR)) return 'r';
+    if (has(m.flags(), MF_PromoB)) return 'b';
+    if (has(m.flags(), MF_PromoN)) return 'n';
     return '\0';
 }
 
@@ -21,55 +24,289 @@ static std::string sqToStr(int sq) {
 }
 
 std::string toUci(const Move& m) {
-    std::string s = sqToStr(m.from) + sqToStr(m.to);
+    std::string s = sqToStr(m.from()) + sqToStr(m.to());
     if (char p = promoChar(m)) s.push_back(p);
     return s;
 }
 
-// recursive helper that accumulates only at the last ply
-static void rec_stats(const Board& b, int depth, PerftStats& out) {
-    auto moves = b.generateLegalMoves();
+bool fromUci(const Board& b, std::string_view text, Move& out) {
+    if (text.size() != 4 && text.size() != 5) return false;
+    for (int i : {0, 2})
+        if (text[i] < 'a' || text[i] > 'h' || text[i + 1] < '1' || text[i + 1] > '8') return false;
+    const int from = (text[0] - 'a') + 8 * (text[1] - '1');
+    const int to = (text[2] - 'a') + 8 * (text[3] - '1');
+    const char promo = text.size() == 5 ? text[4] : '\0';
+
+    MoveList moves;
+    b.generateLegalMoves(moves, GEN_ALL, BB(from));
+    for (const Move& m : moves) {
+        if (m.to() == to && promoChar(m) == promo) {
+            out = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+PerftHash::PerftHash(std::size_t mb) {
+    std::size_t n = 1;
+    while (n * 2 * sizeof(Entry) <= mb * 1024 * 1024) n *= 2;
+    table = std::make_unique<Entry[]>(n);
+    mask = n - 1;
+}
+
+void PerftHash::clear() {
+    for (std::size_t i = 0; i <= mask; ++i) table[i].check.store(0, std::memory_order_relaxed);
+    probes = 0;
+    hits = 0;
+}
+
+// PerftStats as the 7 counters stored in an entry
+using Counters = std::array<std::uint64_t, 7>;
+
+static Counters toCounters(const PerftStats& s) {
+    return { s.nodes, s.captures, s.enPassant, s.castles, s.promotions, s.checks, s.checkmates };
+}
+
+static PerftStats fromCounters(const Counters& c) {
+    PerftStats s;
+    s.nodes      = c[0];
+    s.captures   = c[1];
+    s.enPassant  = c[2];
+    s.castles    = c[3];
+    s.promotions = c[4];
+    s.checks     = c[5];
+    s.checkmates = c[6];
+    return s;
+}
+
+// depth goes into the check word so the same position at another depth never matches
+static U64 depthSalt(int depth) {
+    return static_cast<U64>(depth) * 0x9E3779B97F4A7C15ULL;
+}
+
+bool PerftHash::probe(U64 key, int depth, PerftStats& out) const {
+    const Entry& e = table[key & mask];
+    U64 check = key ^ depthSalt(depth);
+    Counters c;
+    for (int i = 0; i < 7; ++i) {
+        c[i] = e.counters[i].load(std::memory_order_relaxed);
+        check ^= c[i];
+    }
+    if (e.check.load(std::memory_order_relaxed) != check) return false;
+    out = fromCounters(c);
+    return true;
+}
+
+void PerftHash::store(U64 key, int depth, const PerftStats& s) {
+    Entry& e = table[key & mask];
+    U64 check = key ^ depthSalt(depth);
+    const Counters c = toCounters(s);
+    for (int i = 0; i < 7; ++i) {
+        e.counters[i].store(c[i], std::memory_order_relaxed);
+        check ^= c[i];
+    }
+    e.check.store(check, std::memory_order_relaxed); // always replace
+}
+
+static void add(PerftStats& a, const PerftStats& b) {
+    a.nodes      += b.nodes;
+    a.captures   += b.captures;
+    a.enPassant  += b.enPassant;
+    a.castles    += b.castles;
+    a.promotions += b.promotions;
+    a.checks     += b.checks;
+    a.checkmates += b.checkmates;
+}
+
+// hash table and this search's hit counters, flushed to the table once at the end
+struct HashCtx {
+    PerftHash* hash = nullptr;
+    std::uint64_t probes = 0;
+    std::uint64_t hits = 0;
+};
+
+// recursive helper that accumulates only at the last ply.
+// Works on a single mutable board: every child is made and unmade in place.
+static void rec_stats(Board& b, int depth, PerftStats& out, HashCtx& ctx) {
+    // subtree already counted?
+    PerftStats sub{};
+    if (ctx.hash && depth >= 1) {
+        ctx.probes++;
+        if (ctx.hash->probe(b.key, depth, sub)) {
+            ctx.hits++;
+            add(out, sub);
+            return;
+        }
+    }
+
+    MoveList moves;
+    b.generateLegalMoves(moves);
+    StateInfo st;
 
     if (depth == 1) {
         // Count features of these leaf moves
         for (const auto& mv : moves) {
-            out.nodes += 1;
+            sub.nodes += 1;
 
-            if (has(mv.flags, MF_Capture)) {
-                out.captures += 1;
+            if (has(mv.flags(), MF_Capture)) {
+                sub.captures += 1;
             }
-            if (has(mv.flags, MF_EnPassant)) {
-                out.enPassant += 1;
+            if (has(mv.flags(), MF_EnPassant)) {
+                sub.enPassant += 1;
             }
-            if (has(mv.flags, MF_CastleK) || has(mv.flags, MF_CastleQ)) {
-                out.castles += 1;
+            if (has(mv.flags(), MF_CastleK) || has(mv.flags(), MF_CastleQ)) {
+                sub.castles += 1;
             }                   
-            if (has(mv.flags, MF_PromoQ) || has(mv.flags, MF_PromoR) ||
-                has(mv.flags, MF_PromoB) || has(mv.flags, MF_PromoN)) {
-                    out.promotions += 1;
+            if (has(mv.flags(), MF_PromoQ) || has(mv.flags(), MF_PromoR) ||
+                has(mv.flags(), MF_PromoB) || has(mv.flags(), MF_PromoN)) {
+                    sub.promotions += 1;
             }
                                                
 
-            Board child = b.applied(mv);
+            b.makeMove(mv, st);
             // After move, opponent is to move. If they are in check -> this move gives check.
-            if (child.isInCheck(child.sideToMove)) out.checks += 1;
-            if (child.isCheckmate())               out.checkmates += 1;
+            if (b.isInCheck(b.sideToMove)) sub.checks += 1;
+            if (b.isCheckmate())           sub.checkmates += 1;
+            b.unmakeMove(mv);
+        }
+    } else {
+        // Otherwise go deeper
+        for (const auto& mv : moves) {
+            b.makeMove(mv, st);
+            rec_stats(b, depth - 1, sub, ctx);
+            b.unmakeMove(mv);
         }
-        return;
     }
 
-    // Otherwise go deeper
-    for (const auto& mv : moves) {
-        Board child = b.applied(mv);
-        rec_stats(child, depth - 1, out);
-    }
+    // counted into sub so the subtree total can be cached
+    if (ctx.hash) ctx.hash->store(b.key, depth, sub);
+    add(out, sub);
 }
 
-PerftStats perft_stats(const Board& b, int depth) {
+PerftStats perft_stats(const Board& b, int depth, PerftHash* hash) {
     PerftStats s{};
-    if (depth <= 0) return s;
-    rec_stats(b, depth, s);
+    if (depth <= 0) {
+        s.nodes = 1; // perft(0) is the root itself, as perft_nodes counts it
+        return s;
+    }
+    Board work = b; // the only copy, made/unmade in place below
+    HashCtx ctx;
+    ctx.hash = hash;
+    rec_stats(work, depth, s, ctx);
+    if (hash) {
+        hash->probes += ctx.probes;
+        hash->hits += ctx.hits;
+    }
     return s;
 }
 
+// nodes-only entries share the table with full-stats entries; the salt keeps them apart
+static constexpr U64 NODES_ONLY_SALT = 0xD6E8FEB86659FD93ULL;
+
+// bulk counting: the last ply is never made, the size of the legal move list is the answer
+static std::uint64_t rec_nodes(Board& b, int depth, HashCtx& ctx) {
+    MoveList moves;
+    b.generateLegalMoves(moves);
+    if (depth == 1) return static_cast<std::uint64_t>(moves.size());
+
+    PerftStats cached{};
+    if (ctx.hash) {
+        ctx.probes++;
+        if (ctx.hash->probe(b.key ^ NODES_ONLY_SALT, depth, cached)) {
+            ctx.hits++;
+            return cached.nodes;
+        }
+    }
+
+    std::uint64_t nodes = 0;
+    StateInfo st;
+    for (const auto& mv : moves) {
+        b.makeMove(mv, st);
+        nodes += rec_nodes(b, depth - 1, ctx);
+        b.unmakeMove(mv);
+    }
+
+    if (ctx.hash) {
+        cached.nodes = nodes;
+        ctx.hash->store(b.key ^ NODES_ONLY_SALT, depth, cached);
+    }
+    return nodes;
+}
+
+std::uint64_t perft_nodes(const Board& b, int depth, PerftHash* hash) {
+    if (depth <= 0) return 1;
+    Board work = b;
+    HashCtx ctx;
+    ctx.hash = hash;
+    std::uint64_t nodes = rec_nodes(work, depth, ctx);
+    if (hash) {
+        hash->probes += ctx.probes;
+        hash->hits += ctx.hits;
+    }
+    return nodes;
+}
+
+// expand the frontier one ply at a time until there are enough subtrees to balance the
+// workers (or only two plies are left, which are always searched inside a task)
+static std::vector<Board> split_frontier(const Board& b, int depth, int workers, int& remaining) {
+    const std::size_t wanted = static_cast<std::size_t>(workers) * 8;
+    std::vector<Board> frontier{b};
+    remaining = depth;
+    while (frontier.size() < wanted && remaining > 2) {
+        std::vector<Board> deeper;
+        for (const Board& node : frontier) {
+            MoveList moves;
+            node.generateLegalMoves(moves);
+            for (const auto& mv : moves) deeper.push_back(node.applied(mv));
+        }
+        frontier.swap(deeper);
+        --remaining;
+    }
+    return frontier;
+}
+
+// per-worker accumulator on its own cache line, so workers never write to a shared line
+struct alignas(64) WorkerStats {
+    PerftStats stats{};
+};
+
+PerftStats perft_stats_parallel(const Board& b, int depth, ThreadPool& pool, PerftHash* hash) {
+    if (depth <= 1) return perft_stats(b, depth, hash);
+
+    int remaining = 0;
+    const std::vector<Board> frontier = split_frontier(b, depth, pool.size(), remaining);
+
+    std::vector<WorkerStats> perWorker(pool.size());
+    for (const Board& node : frontier) {
+        pool.submit([&perWorker, &node, remaining, hash](int worker) {
+            add(perWorker[worker].stats, perft_stats(node, remaining, hash));
+        });
+    }
+    pool.wait();
+
+    PerftStats total{};
+    for (const auto& w : perWorker) add(total, w.stats);
+    return total;
+}
+
+std::uint64_t perft_nodes_parallel(const Board& b, int depth, ThreadPool& pool, PerftHash* hash) {
+    if (depth <= 1) return perft_nodes(b, depth, hash);
+
+    int remaining = 0;
+    const std::vector<Board> frontier = split_frontier(b, depth, pool.size(), remaining);
+
+    std::vector<WorkerStats> perWorker(pool.size());
+    for (const Board& node : frontier) {
+        pool.submit([&perWorker, &node, remaining, hash](int worker) {
+            perWorker[worker].stats.nodes += perft_nodes(node, remaining, hash);
+        });
+    }
+    pool.wait();
+
+    std::uint64_t total = 0;
+    for (const auto& w : perWorker) total += w.stats.nodes;
+    return total;
+}
+
 } // namespace chess
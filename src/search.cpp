@@ -0,0 +1,569 @@
+#include "chess/search.hpp"
+#include "chess/board.hpp"
+#include "chess/eval.hpp"
+#include "chess/movepick.hpp"
+#include "chess/see.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace chess {
+
+void TimeManager::init(const SearchLimits& limits, Color us) {
+    start = std::chrono::steady_clock::now();
+    optimum = maximum = 0;
+
+    if (limits.infinite) return;
+
+    if (limits.movetime > 0) {
+        optimum = maximum = std::max<std::int64_t>(1, limits.movetime - MOVE_OVERHEAD);
+        return;
+    }
+
+    const std::int64_t time = (us == WHITE) ? limits.wtime : limits.btime;
+    const std::int64_t inc  = (us == WHITE) ? limits.winc  : limits.binc;
+    if (time <= 0) return; // depth/nodes limited (or unlimited) search
+
+    // spread the clock over the moves still to play, plus most of the increment
+    const std::int64_t left = std::max<std::int64_t>(1, time - MOVE_OVERHEAD);
+    const int movesLeft = limits.movestogo > 0 ? std::min(limits.movestogo, 50) : 30;
+
+    optimum = left / movesLeft + inc * 3 / 4;
+    // an iteration may overrun the optimum, but never more than 5x, nor past 80% of the clock
+    maximum = std::min(optimum * 5, left * 8 / 10);
+    optimum = std::max<std::int64_t>(1, std::min(optimum, maximum));
+    maximum = std::max<std::int64_t>(1, maximum);
+}
+
+std::int64_t TimeManager::elapsed() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// network evaluations a search thread keeps, by position key (see staticEval)
+static constexpr std::size_t EVAL_CACHE_SIZE = 1 << 15;
+
+// Everything one search thread owns. Threads share nothing but the transposition table
+// (and the stop flag), so they never wait on each other.
+struct SearchThread {
+    int id = 0;
+    Board board;                             // searched in place with make/unmake
+    std::atomic<std::uint64_t> nodes{0};     // written by this thread only, summed by the main one
+    Move rootBest{};                         // best move of the previous iteration, searched first
+    Move killers[MAX_PLY][2] = {};           // quiet moves that failed high at this ply
+    ButterflyHistory history = {};           // quiet cutoffs by side, from, to
+    ContinuationHistory contHist = {};       // quiet cutoffs following the previous move
+    CounterMoves counters = {};              // quiet refutation of the previous move
+    Move stack[MAX_PLY + 1] = {};            // move being searched at each ply
+    std::atomic<std::uint64_t> cutoffs{0};           // fail-highs
+    std::atomic<std::uint64_t> firstMoveCutoffs{0};  // fail-highs on the first move searched
+
+    // triangular PV table: pv[ply] holds the line from ply onwards
+    Move pv[MAX_PLY + 1][MAX_PLY + 1] = {};
+    int pvLength[MAX_PLY + 1] = {};
+
+    SearchInfo completed;                    // last iteration this thread finished
+
+    // key high half and score, indexed by the low bits; kept while the network stays the same
+    std::vector<U64> evalCache = std::vector<U64>(EVAL_CACHE_SIZE);
+    const NnueNetwork* evalCacheNet = nullptr;
+
+    void reset(const Board& root) {
+        board = root;
+        // pick up the current network, with an accumulator of the board's own: the root's
+        // undo records are shared with the other threads and must not be computed into
+        board.recompute();
+        if (evalCacheNet != board.accNet) {
+            std::fill(evalCache.begin(), evalCache.end(), 0);
+            evalCacheNet = board.accNet;
+        }
+        nodes.store(0, std::memory_order_relaxed);
+        rootBest = Move{};
+        for (auto& k : killers) k[0] = k[1] = Move{};
+        std::fill_n(&history[0][0][0], sizeof(history) / sizeof(int), 0);
+        std::fill_n(&contHist[0][0][0][0], sizeof(contHist) / sizeof(int), 0);
+        std::fill_n(&counters[0][0], PIECE_N * 64, Move{});
+        cutoffs.store(0, std::memory_order_relaxed);
+        firstMoveCutoffs.store(0, std::memory_order_relaxed);
+        completed = SearchInfo{};
+    }
+};
+
+Search::Search() { setThreads(1); }
+Search::~Search() = default;
+
+void Search::setThreads(int n) {
+    n = std::max(n, 1);
+    threads.resize(n);
+    for (int i = 0; i < n; ++i) {
+        if (!threads[i]) threads[i] = std::make_unique<SearchThread>();
+        threads[i]->id = i;
+    }
+}
+
+void Search::clearHash() {
+    tt.clear(threadCount());
+    for (auto& t : threads) t->evalCacheNet = nullptr; // emptied by the next reset
+}
+
+std::uint64_t Search::nodes() const {
+    std::uint64_t n = 0;
+    for (const auto& t : threads) n += t->nodes.load(std::memory_order_relaxed);
+    return n;
+}
+
+// search-wide figures of an info: nodes, time, speed, table use and cutoff counts
+void Search::fillCounters(SearchInfo& info) const {
+    info.nodes = nodes();
+    info.ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    info.nps = info.ms > 0 ? info.nodes * 1000 / static_cast<std::uint64_t>(info.ms) : 0;
+    info.hashfull = tt.hashfull();
+    info.cutoffs = info.firstMoveCutoffs = 0;
+    for (const auto& t : threads) {
+        info.cutoffs += t->cutoffs.load(std::memory_order_relaxed);
+        info.firstMoveCutoffs += t->firstMoveCutoffs.load(std::memory_order_relaxed);
+    }
+}
+
+// main thread only: once ponderhit() came, arm the time manager from now on
+void Search::startClockOnPonderhit() {
+    if (clockStopped && !pondering.load(std::memory_order_relaxed)) {
+        clockStopped = false;
+        SearchLimits timed = limits;
+        timed.ponder = false;
+        tm.init(timed, rootSide);
+    }
+}
+
+// polled every 1024 nodes of the main thread: the hard deadline and the node budget end the search
+void Search::checkLimits() {
+    startClockOnPonderhit();
+    if (tm.hardExpired() || (limits.nodes && nodes() >= limits.nodes)) {
+        stopFlag.store(true, std::memory_order_relaxed);
+    }
+}
+
+static bool isQuiet(const Move& m) {
+    return !has(m.flags(), MF_Capture) && !has(m.flags(), MF_PromoMask);
+}
+
+// mate scores are stored relative to the stored node, not to the root
+static int scoreToTT(int s, int ply) {
+    if (s >= VALUE_MATE_IN_MAX_PLY) return s + ply;
+    if (s <= -VALUE_MATE_IN_MAX_PLY) return s - ply;
+    return s;
+}
+
+static int scoreFromTT(int s, int ply) {
+    if (s >= VALUE_MATE_IN_MAX_PLY) return s - ply;
+    if (s <= -VALUE_MATE_IN_MAX_PLY) return s + ply;
+    return s;
+}
+
+// new principal variation at ply: mv followed by the child's line
+static void updatePv(SearchThread& t, int ply, const Move& mv) {
+    t.pv[ply][ply] = mv;
+    for (int i = ply + 1; i < t.pvLength[ply + 1]; ++i) t.pv[ply][i] = t.pv[ply + 1][i];
+    t.pvLength[ply] = std::max(t.pvLength[ply + 1], ply + 1);
+}
+
+// Static evaluation, through the thread's cache while a network evaluates: iterative
+// deepening and transpositions bring the same positions back, and a hit skips both the
+// network and the accumulator update. The classical evaluation is cheaper than a probe.
+static int staticEval(SearchThread& t) {
+    const Board& b = t.board;
+    if (!b.accNet) return evaluate(b);
+    U64& e = t.evalCache[b.key & (EVAL_CACHE_SIZE - 1)];
+    if ((e >> 32) == (b.key >> 32)) return static_cast<std::int32_t>(static_cast<std::uint32_t>(e));
+    const int score = evaluate(b);
+    e = (b.key & 0xFFFFFFFF00000000ULL) | static_cast<std::uint32_t>(score);
+    return score;
+}
+
+// a capture that cannot lift stand pat to within this of alpha is not searched
+static constexpr int DELTA_MARGIN = 200;
+
+// Captures and promotions only, until the position is quiet. The side to move may stand
+// pat on the static evaluation; in check it must answer with any evasion instead.
+int Search::quiesce(SearchThread& t, int ply, int alpha, int beta) {
+    t.pvLength[ply] = ply;
+    const std::uint64_t n = t.nodes.load(std::memory_order_relaxed) + 1;
+    t.nodes.store(n, std::memory_order_relaxed);
+    if (t.id == 0 && (n & 1023) == 0) checkLimits();
+    if (stopFlag.load(std::memory_order_relaxed)) return 0;
+
+    Board& b = t.board;
+    if (ply >= MAX_PLY) return evaluate(b);
+
+    const bool inCheck = b.checkers() != 0;
+    int best = -VALUE_INF;
+    int standPat = 0;
+    if (!inCheck) {
+        standPat = staticEval(t);
+        if (standPat >= beta) return standPat;
+        alpha = std::max(alpha, standPat);
+        best = standPat;
+    }
+
+    MovePicker picker(b, inCheck);
+    StateInfo st;
+    Move mv;
+    int legal = 0;
+    while (picker.next(mv)) {
+        ++legal;
+        if (!inCheck) {
+            // delta pruning: winning the piece on to (and promoting) still leaves us below alpha
+            const Piece victim = has(mv.flags(), MF_EnPassant) ? PAWN : b.pieceOn(mv.to());
+            int gain = victim == PIECE_N ? 0 : PIECE_VALUE[victim];
+            if (has(mv.flags(), MF_PromoMask)) gain += PIECE_VALUE[promoPiece(mv.flags())] - PIECE_VALUE[PAWN];
+            if (standPat + gain + DELTA_MARGIN <= alpha) continue;
+            // captures that lose material in the exchange are not worth a node
+            if (!seeGE(b, mv, 0)) continue;
+        }
+
+        t.stack[ply] = mv;
+        b.makeMove(mv, st);
+        const int score = -quiesce(t, ply + 1, -beta, -alpha);
+        b.unmakeMove(mv);
+        if (stopFlag.load(std::memory_order_relaxed)) return 0;
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                updatePv(t, ply, mv);
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    // in check every evasion was generated: none means mate
+    if (inCheck && legal == 0) return -VALUE_MATE + ply;
+    return best;
+}
+
+// A quiet move failed high: make it a killer and the counter of the previous move, and
+// move the histories towards it and away from the quiet moves tried before it.
+static void updateQuietStats(SearchThread& t, int ply, int depth, const Move& mv,
+                             const Move* tried, int triedCount) {
+    if (t.killers[ply][0] != mv) {
+        t.killers[ply][1] = t.killers[ply][0];
+        t.killers[ply][0] = mv;
+    }
+
+    const Board& b = t.board;
+    const Color us = b.sideToMove;
+    const Move prev = ply > 0 ? t.stack[ply - 1] : Move{};
+    const bool hasPrev = prev != Move{};
+    // moves carry no piece: the previous one's stands on its to square, ours on from
+    const Piece prevPiece = hasPrev ? b.pieceOn(prev.to()) : PIECE_N;
+    if (hasPrev) t.counters[prevPiece][prev.to()] = mv;
+
+    const int bonus = std::min(depth * depth, HISTORY_MAX);
+    updateHistory(t.history[us][mv.from()][mv.to()], bonus);
+    if (hasPrev) updateHistory(t.contHist[prevPiece][prev.to()][b.pieceOn(mv.from())][mv.to()], bonus);
+    for (int i = 0; i < triedCount; ++i) {
+        const Move& q = tried[i];
+        updateHistory(t.history[us][q.from()][q.to()], -bonus);
+        if (hasPrev) updateHistory(t.contHist[prevPiece][prev.to()][b.pieceOn(q.from())][q.to()], -bonus);
+    }
+}
+
+// Late-move reduction in plies by depth and move number: grows with the log of both
+static const auto LMR_TABLE = [] {
+    std::array<std::array<int, 64>, 64> r{};
+    for (int d = 1; d < 64; ++d)
+        for (int m = 1; m < 64; ++m)
+            r[d][m] = static_cast<int>(0.75 + std::log(d) * std::log(m) / 2.25);
+    return r;
+}();
+
+static constexpr int RFP_MARGIN = 80;    // reverse futility margin per ply of depth
+static constexpr int RFP_DEPTH = 6;      // deepest node it applies to
+static constexpr int LMP_DEPTH = 4;      // late-move pruning applies up to this depth...
+static int lmpQuiets(int depth) { return 3 + depth * depth; } // ...after this many quiet moves
+
+int Search::negamax(SearchThread& t, int depth, int ply, int alpha, int beta) {
+    Board& b = t.board;
+    if (depth <= 0) return quiesce(t, ply, alpha, beta);
+
+    t.pvLength[ply] = ply;
+    const std::uint64_t n = t.nodes.load(std::memory_order_relaxed) + 1;
+    t.nodes.store(n, std::memory_order_relaxed);
+    if (t.id == 0 && (n & 1023) == 0) checkLimits();
+    if (stopFlag.load(std::memory_order_relaxed)) return 0;
+
+    if (ply >= MAX_PLY) return evaluate(b);
+
+    // draws, never at the root (it must return a move): a repetition or the fifty-move
+    // rule ends the node; a reversible move back to a position of the search is a draw
+    // the side to move can claim, so the score is at least that
+    if (ply > 0) {
+        if (b.isDraw(ply)) return 0;
+        if (opts.upcomingRepetition && alpha < 0 && b.hasUpcomingRepetition(ply)) {
+            alpha = 0;
+            if (alpha >= beta) return alpha;
+        }
+    }
+
+    // a deep enough stored result ends the node (never at the root, it must set the PV)
+    const int alphaOrig = alpha;
+    const bool pvNode = beta - alpha > 1;
+    U16 hashMove = 0;
+    TTEntry tte;
+    if (tt.probe(b.key, tte)) {
+        hashMove = tte.move;
+        if (ply > 0 && tte.depth >= depth) {
+            const int s = scoreFromTT(tte.score, ply);
+            if (tte.bound == BOUND_EXACT
+                || (tte.bound == BOUND_LOWER && s >= beta)
+                || (tte.bound == BOUND_UPPER && s <= alpha)) {
+                return s;
+            }
+        }
+    }
+
+    const Color us = b.sideToMove;
+    const bool inCheck = b.checkers() != 0;
+    const Move prev = ply > 0 ? t.stack[ply - 1] : Move{};
+    const bool hasPrev = prev != Move{};
+    const Piece prevPiece = hasPrev ? b.pieceOn(prev.to()) : PIECE_N;
+
+    // node pruning, only in zero-window nodes (the only ones that need the static eval)
+    if (!pvNode && !inCheck && std::abs(beta) < VALUE_MATE_IN_MAX_PLY && (opts.reverseFutility || opts.nullMove)) {
+        const int eval = staticEval(t);
+
+        // reverse futility: even giving back a margin per ply, we stay above beta
+        if (opts.reverseFutility && depth <= RFP_DEPTH && eval - RFP_MARGIN * depth >= beta) {
+            return eval;
+        }
+
+        // null move: if passing still fails high, a real move would too. Not twice in a
+        // row, and not with a single piece (or none) besides king and pawns, where passing
+        // may be the best move there is (zugzwang)
+        const bool fewPieces = std::popcount(b.occ[us] & ~(b.bb[us][PAWN] | b.bb[us][KING])) < 2;
+        if (opts.nullMove && depth >= 3 && hasPrev && eval >= beta && !fewPieces) {
+            const int r = 3 + depth / 6;
+            t.stack[ply] = Move{};
+            StateInfo nst;
+            b.makeNullMove(nst);
+            const int score = -negamax(t, depth - 1 - r, ply + 1, -beta, -beta + 1);
+            b.unmakeNullMove();
+            if (stopFlag.load(std::memory_order_relaxed)) return 0;
+            // an unproven mate from a null move is not trusted
+            if (score >= beta) return score >= VALUE_MATE_IN_MAX_PLY ? beta : score;
+        }
+    }
+
+    if (ply == 0 && t.rootBest != Move{}) hashMove = packMove(t.rootBest);
+    MovePicker picker(b, hashMove, t.killers[ply], hasPrev ? t.counters[prevPiece][prev.to()] : Move{},
+                      t.history[us], hasPrev ? t.contHist[prevPiece][prev.to()] : nullptr);
+
+    int best = -VALUE_INF;
+    Move bestMove{};
+    StateInfo st;
+    Move mv;
+    int legal = 0;
+    Move quietsTried[64];
+    int quietCount = 0;
+    while (picker.next(mv)) {
+        ++legal;
+        const bool quiet = isQuiet(mv);
+
+        // late-move pruning: far enough down a shallow list, quiet moves will not fail high
+        if (opts.lateMovePruning && !pvNode && !inCheck && depth <= LMP_DEPTH && quiet
+            && best > -VALUE_MATE_IN_MAX_PLY && quietCount >= lmpQuiets(depth)) {
+            picker.skipQuiets();
+            continue;
+        }
+
+        t.stack[ply] = mv;
+        tt.prefetch(b.keyAfter(mv)); // the child probes its entry right away
+        b.makeMove(mv, st);
+        const bool givesCheck = b.isInCheck();
+
+        // principal variation search: the first move with the full window, the others
+        // with a null window (reduced if late and quiet), searched again if they beat alpha
+        int score;
+        if (legal == 1) {
+            score = -negamax(t, depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            int r = 0;
+            if (opts.lmr && depth >= 3 && quiet && !inCheck && !givesCheck) {
+                r = LMR_TABLE[std::min(depth, 63)][std::min(legal, 63)] - (pvNode ? 1 : 0);
+                r = std::clamp(r, 0, depth - 2);
+            }
+            score = -negamax(t, depth - 1 - r, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && r > 0) score = -negamax(t, depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) score = -negamax(t, depth - 1, ply + 1, -beta, -alpha);
+        }
+        b.unmakeMove(mv);
+
+        // an aborted child returns garbage, do not let it change the result
+        if (stopFlag.load(std::memory_order_relaxed)) return 0;
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                bestMove = mv;
+                alpha = score;
+                updatePv(t, ply, mv);
+                if (alpha >= beta) {
+                    // fail high, the opponent avoids this line
+                    t.cutoffs.store(t.cutoffs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    if (legal == 1) {
+                        t.firstMoveCutoffs.store(t.firstMoveCutoffs.load(std::memory_order_relaxed) + 1,
+                                                 std::memory_order_relaxed);
+                    }
+                    if (quiet) updateQuietStats(t, ply, depth, mv, quietsTried, quietCount);
+                    break;
+                }
+            }
+        }
+        if (quiet && quietCount < 64) quietsTried[quietCount++] = mv;
+    }
+
+    if (legal == 0) {
+        // checkmate (prefer the shortest) or stalemate
+        return inCheck ? -VALUE_MATE + ply : 0;
+    }
+
+    const Bound bound = best >= beta ? BOUND_LOWER : best > alphaOrig ? BOUND_EXACT : BOUND_UPPER;
+    // a fail-low has no best move worth keeping
+    tt.store(b.key, scoreToTT(best, ply), depth, bound, bound == BOUND_UPPER ? 0 : packMove(bestMove));
+    return best;
+}
+
+// Helper threads skip some depths, so they spread over different iterations instead of
+// all searching the one the main thread is on (pattern from Stockfish 9).
+static constexpr int SKIP_SIZE[]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static constexpr int SKIP_PHASE[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+static constexpr int ASPIRATION_DEPTH = 5;   // first iteration searched with a window
+static constexpr int ASPIRATION_WINDOW = 25; // half width, doubled on every failure
+
+// iterative deepening of one thread; only the main thread reports and manages time
+void Search::iterate(SearchThread& t, int maxDepth, const InfoFn& onIteration) {
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        if (t.id > 0) {
+            const int i = (t.id - 1) % 20;
+            if (((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2) continue;
+        }
+
+        // aspiration: expect the score near the last one, widen the failing side until
+        // the result falls inside the window
+        int score;
+        const int last = t.completed.score;
+        if (opts.aspiration && depth >= ASPIRATION_DEPTH && t.completed.depth > 0
+            && std::abs(last) < VALUE_MATE_IN_MAX_PLY) {
+            int delta = ASPIRATION_WINDOW;
+            int alpha = last - delta;
+            int beta = last + delta;
+            while (true) {
+                score = negamax(t, depth, 0, alpha, beta);
+                if (stopFlag.load(std::memory_order_relaxed)) break;
+                if (score <= alpha) alpha = std::max(score - delta, -VALUE_INF);
+                else if (score >= beta) beta = std::min(score + delta, VALUE_INF);
+                else break;
+                delta *= 2;
+            }
+        } else {
+            score = negamax(t, depth, 0, -VALUE_INF, VALUE_INF);
+        }
+
+        // an interrupted iteration is thrown away (its best move may be half searched)
+        if (stopFlag.load(std::memory_order_relaxed)) break;
+
+        t.completed.depth = depth;
+        t.completed.score = score;
+        t.completed.pv.assign(t.pv[0], t.pv[0] + t.pvLength[0]);
+        t.rootBest = t.pv[0][0];
+
+        if (t.id != 0) continue;
+
+        SearchInfo info = t.completed;
+        fillCounters(info);
+        if (onIteration) onIteration(info);
+
+        startClockOnPonderhit();
+        if (tm.softExpired()) break;
+        // a mate within the searched depth will not change with more depth
+        if (!limits.infinite && !clockStopped && std::abs(score) >= VALUE_MATE_IN_MAX_PLY && VALUE_MATE - std::abs(score) <= depth) break;
+    }
+}
+
+// Every thread that finished an iteration votes for its move, weighted by its depth and
+// by how much better its score is than the worst one; the best-voted thread's result wins.
+SearchInfo Search::pickBest() const {
+    const SearchThread* best = threads[0].get();
+    if (threads.size() == 1) return best->completed;
+
+    int minScore = VALUE_INF;
+    for (const auto& t : threads)
+        if (t->completed.depth > 0) minScore = std::min(minScore, t->completed.score);
+
+    std::vector<std::pair<Move, std::int64_t>> votes;
+    for (const auto& t : threads) {
+        if (t->completed.depth == 0) continue;
+        const Move m = t->completed.pv[0];
+        const std::int64_t weight = static_cast<std::int64_t>(t->completed.score - minScore + 14) * t->completed.depth;
+        const auto it = std::find_if(votes.begin(), votes.end(), [&m](const auto& v) { return v.first == m; });
+        if (it == votes.end()) votes.emplace_back(m, weight);
+        else it->second += weight;
+    }
+    // read by value once all votes are in: no reference into votes outlives an insertion
+    auto votesFor = [&votes](const Move& m) {
+        for (const auto& v : votes) if (v.first == m) return v.second;
+        return std::int64_t{0};
+    };
+
+    for (const auto& t : threads) {
+        if (t->completed.depth == 0) continue;
+        if (best->completed.depth == 0 || votesFor(t->completed.pv[0]) > votesFor(best->completed.pv[0])) best = t.get();
+    }
+    return best->completed;
+}
+
+SearchInfo Search::go(const Board& root, const SearchLimits& lim, const InfoFn& onIteration) {
+    limits = lim;
+    stopFlag.store(false, std::memory_order_relaxed);
+    tt.newSearch();
+    startTime = std::chrono::steady_clock::now();
+    rootSide = root.sideToMove;
+    // while pondering the clock does not run: no deadlines until ponderhit()
+    pondering.store(limits.ponder, std::memory_order_relaxed);
+    clockStopped = limits.ponder;
+    SearchLimits timed = limits;
+    if (limits.ponder) timed = SearchLimits{};
+    tm.init(timed, rootSide);
+    for (auto& t : threads) t->reset(root);
+
+    MoveList rootMoves;
+    root.generateLegalMoves(rootMoves);
+    if (rootMoves.empty()) return SearchInfo{}; // game over, nothing to play
+
+    const int maxDepth = limits.depth > 0 ? std::min(limits.depth, MAX_PLY) : MAX_PLY;
+
+    std::vector<std::thread> helpers;
+    for (std::size_t i = 1; i < threads.size(); ++i) {
+        helpers.emplace_back([this, i, maxDepth] { iterate(*threads[i], maxDepth, {}); });
+    }
+    iterate(*threads[0], maxDepth, onIteration);
+    // the main thread decides when the search is over
+    stop();
+    for (auto& h : helpers) h.join();
+
+    SearchInfo result = pickBest();
+    // whatever happens, there is a move to play
+    if (result.pv.empty()) result.pv.push_back(rootMoves[0]);
+    fillCounters(result);
+    return result;
+}
+
+} // namespace chess
@@ -0,0 +1,75 @@
+#include "chess/see.hpp"
+#include "chess/attacks.hpp"
+#include "chess/board.hpp"
+#include "chess/eval.hpp"
+
+#include <algorithm>
+
+namespace chess {
+
+int see(const Board& b, const Move& m) {
+    const Square to = static_cast<Square>(m.to());
+    const U64 lastRanks = RANK_1 | RANK_8;
+    const U64 diagonal = b.bb[WHITE][BISHOP] | b.bb[BLACK][BISHOP] | b.bb[WHITE][QUEEN] | b.bb[BLACK][QUEEN];
+    const U64 straight = b.bb[WHITE][ROOK] | b.bb[BLACK][ROOK] | b.bb[WHITE][QUEEN] | b.bb[BLACK][QUEEN];
+
+    // gain[d]: what the side making capture d has won once it is made, if nobody goes on
+    int gain[32];
+    int d = 0;
+
+    U64 occupied = b.occAll ^ BB(m.from());
+    Piece onSquare = b.pieceOn(m.from()); // piece standing on to, the next one to be taken
+    if (has(m.flags(), MF_EnPassant)) {
+        occupied ^= BB(b.sideToMove == WHITE ? m.to() - 8 : m.to() + 8);
+        gain[0] = PIECE_VALUE[PAWN];
+    } else {
+        const Piece victim = b.pieceOn(m.to());
+        gain[0] = victim == PIECE_N ? 0 : PIECE_VALUE[victim];
+    }
+    if (has(m.flags(), MF_PromoMask)) {
+        onSquare = promoPiece(m.flags());
+        gain[0] += PIECE_VALUE[onSquare] - PIECE_VALUE[PAWN];
+    }
+
+    U64 attackers = b.attackersTo(to, occupied) & occupied;
+    Color side = other(b.sideToMove);
+    while (d < 31) {
+        attackers &= occupied;
+        const U64 mine = attackers & b.occ[side];
+        if (!mine) break;
+
+        // least valuable attacker
+        Piece p = PAWN;
+        while (!(mine & b.bb[side][p])) p = static_cast<Piece>(p + 1);
+        // the king cannot take a defended piece
+        if (p == KING && (attackers & b.occ[other(side)])) break;
+        const U64 from = mine & b.bb[side][p] & -(mine & b.bb[side][p]);
+
+        ++d;
+        gain[d] = PIECE_VALUE[onSquare] - gain[d - 1];
+        onSquare = p;
+        if (p == PAWN && (BB(to) & lastRanks)) {
+            onSquare = QUEEN;
+            gain[d] += PIECE_VALUE[QUEEN] - PIECE_VALUE[PAWN];
+        }
+
+        // the capturer leaves its square, which can uncover a slider behind it
+        occupied ^= from;
+        if (p == PAWN || p == BISHOP || p == QUEEN) attackers |= bishopAttacks(to, occupied) & diagonal;
+        if (p == ROOK || p == QUEEN) attackers |= rookAttacks(to, occupied) & straight;
+        side = other(side);
+    }
+
+    // going backwards, each side takes the better of stopping and capturing
+    while (d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        --d;
+    }
+    return gain[0];
+}
+
+bool seeGE(const Board& b, const Move& m, int threshold) {
+    return see(b, m) >= threshold;
+}
+
+} // namespace chess
@@ -0,0 +1,92 @@
+#include "chess/thread_pool.hpp"
+
+namespace chess {
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads < 1) threads = 1;
+    for (int i = 0; i < threads; ++i) queues.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < threads; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void ThreadPool::submit(Task task) {
+    std::size_t target;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        target = next++ % queues.size();
+        ++unfinished; // before the push: a worker may pop and finish it right away
+    }
+    {
+        // counted once it is in the deque, so a woken worker finds something to pop; the
+        // deque stays locked until then so the task cannot be popped before it is counted.
+        // Nothing takes a deque lock while holding m, so the nesting cannot deadlock.
+        std::lock_guard<std::mutex> qlock(queues[target]->m);
+        queues[target]->tasks.push_back(std::move(task));
+        std::lock_guard<std::mutex> lock(m);
+        ++queued;
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m);
+    idle.wait(lock, [&] { return unfinished == 0; });
+}
+
+bool ThreadPool::tryPop(int self, Task& out) {
+    // own deque first (newest task, still warm in cache)
+    {
+        Queue& q = *queues[self];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.tasks.empty()) {
+            out = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+    // then steal the oldest task of another worker
+    const int n = size();
+    for (int i = 1; i < n; ++i) {
+        Queue& q = *queues[(self + i) % n];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.tasks.empty()) {
+            out = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int id) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            wake.wait(lock, [&] { return stop || queued > 0; });
+            if (stop && queued == 0) return;
+        }
+
+        Task task;
+        if (!tryPop(id, task)) continue; // another worker got there first
+
+        {
+            std::lock_guard<std::mutex> lock(m);
+            --queued;
+        }
+        task(id);
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (--unfinished == 0) idle.notify_all();
+        }
+    }
+}
+
+} // namespace chess
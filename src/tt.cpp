@@ -0,0 +1,144 @@
+#include "chess/tt.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace chess {
+
+static constexpr U64 KEY_MASK = (1ULL << TranspositionTable::KEY_BITS) - 1;
+
+static U64 pack(const TTEntry& e) {
+    return static_cast<U64>(e.key18 & KEY_MASK)
+         | static_cast<U64>(e.move) << 18
+         | static_cast<U64>(static_cast<U16>(e.score)) << 34
+         | static_cast<U64>(e.depth & TranspositionTable::DEPTH_MAX) << 50
+         | static_cast<U64>(e.bound) << 57
+         | static_cast<U64>(e.generation & TranspositionTable::GENERATION_MASK) << 59;
+}
+
+static TTEntry unpack(U64 w) {
+    TTEntry e;
+    e.key18 = static_cast<uint32_t>(w & KEY_MASK);
+    e.move = static_cast<U16>(w >> 18);
+    e.score = static_cast<int16_t>(static_cast<U16>(w >> 34));
+    e.depth = static_cast<uint8_t>((w >> 50) & TranspositionTable::DEPTH_MAX);
+    e.bound = static_cast<Bound>((w >> 57) & 3);
+    e.generation = static_cast<uint8_t>(w >> 59);
+    return e;
+}
+
+// slots are shared between search threads: every access is one relaxed atomic word
+static U64 loadSlot(const U64& slot) {
+    return std::atomic_ref<U64>(const_cast<U64&>(slot)).load(std::memory_order_relaxed);
+}
+
+static void storeSlot(U64& slot, U64 w) {
+    std::atomic_ref<U64>(slot).store(w, std::memory_order_relaxed);
+}
+
+TranspositionTable::~TranspositionTable() {
+    std::free(table);
+}
+
+void TranspositionTable::resize(std::size_t mb) {
+    mb = std::max<std::size_t>(mb, 1);
+    if (mb == sizeMb && table) return;
+
+    std::free(table);
+    table = nullptr;
+    clusterCount = mb * 1024 * 1024 / sizeof(Cluster); // exact: 1 MiB is a whole number of clusters
+    table = static_cast<Cluster*>(std::aligned_alloc(alignof(Cluster), clusterCount * sizeof(Cluster)));
+    if (!table) {
+        clusterCount = sizeMb = 0;
+        throw std::bad_alloc();
+    }
+    sizeMb = mb;
+    clear();
+}
+
+void TranspositionTable::clear(int threads) {
+    threads = std::max(threads, 1);
+    // every thread zeroes its own contiguous slice (touching the pages from that thread)
+    const std::size_t chunk = (clusterCount + threads - 1) / threads;
+    auto zero = [this, chunk](int i) {
+        const std::size_t begin = std::min(clusterCount, chunk * i);
+        const std::size_t end = std::min(clusterCount, begin + chunk);
+        std::memset(static_cast<void*>(table + begin), 0, (end - begin) * sizeof(Cluster));
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) workers.emplace_back(zero, i);
+    zero(0);
+    for (auto& t : workers) t.join();
+    generation8 = 0;
+}
+
+bool TranspositionTable::probe(U64 key, TTEntry& out) const {
+    const Cluster& c = *clusterOf(key);
+    const U64 key18 = key & KEY_MASK;
+    for (int i = 0; i < CLUSTER_SIZE; ++i) {
+        const U64 w = loadSlot(c.slots[i]);
+        if ((w & KEY_MASK) == key18 && ((w >> 57) & 3) != BOUND_NONE) {
+            out = unpack(w);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(U64 key, int score, int depth, Bound bound, U16 move) {
+    Cluster& c = *clusterOf(key);
+    const uint32_t key18 = static_cast<uint32_t>(key & KEY_MASK);
+
+    // same position already stored? overwrite it. Otherwise replace the slot that is
+    // worth least: shallow, and written by an old search (empty slots have depth 0, age 0
+    // but are taken first anyway)
+    int victim = 0;
+    int victimWorth = 1 << 30;
+    TTEntry old;
+    for (int i = 0; i < CLUSTER_SIZE; ++i) {
+        const TTEntry e = unpack(loadSlot(c.slots[i]));
+        if (e.bound == BOUND_NONE || e.key18 == key18) {
+            victim = i;
+            old = e;
+            break;
+        }
+        const int age = (generation8 - e.generation) & GENERATION_MASK;
+        const int worth = e.depth - 8 * age;
+        if (worth < victimWorth) {
+            victimWorth = worth;
+            victim = i;
+        }
+    }
+
+    // a bound without a move must not erase the move known for this position
+    if (move == 0 && old.bound != BOUND_NONE && old.key18 == key18) move = old.move;
+
+    TTEntry e;
+    e.key18 = key18;
+    e.move = move;
+    e.score = static_cast<int16_t>(score);
+    e.depth = static_cast<uint8_t>(std::clamp(depth, 0, DEPTH_MAX));
+    e.bound = bound;
+    e.generation = generation8;
+    storeSlot(c.slots[victim], pack(e));
+}
+
+int TranspositionTable::hashfull() const {
+    const std::size_t sample = std::min<std::size_t>(clusterCount, 1000);
+    std::size_t used = 0;
+    for (std::size_t i = 0; i < sample; ++i) {
+        for (int j = 0; j < CLUSTER_SIZE; ++j) {
+            const TTEntry e = unpack(loadSlot(table[i].slots[j]));
+            if (e.bound != BOUND_NONE && e.generation == generation8) ++used;
+        }
+    }
+    return static_cast<int>(used * 1000 / (sample * CLUSTER_SIZE));
+}
+
+} // namespace chess
@@ -0,0 +1,263 @@
+#include "chess/uci.hpp"
+#include "chess/debug.hpp"
+#include "chess/fen.hpp"
+#include "chess/nnue.hpp"
+#include "chess/perft.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace chess {
+
+static constexpr int DEFAULT_HASH_MB = 16;
+
+// "cp 35" or "mate 3" (moves, negative when getting mated)
+static std::string scoreText(int score) {
+    if (std::abs(score) >= VALUE_MATE_IN_MAX_PLY) {
+        const int plies = VALUE_MATE - std::abs(score);
+        const int moves = (plies + 1) / 2;
+        return "mate " + std::to_string(score > 0 ? moves : -moves);
+    }
+    return "cp " + std::to_string(score);
+}
+
+static std::string infoLine(const SearchInfo& info) {
+    std::string s = "info depth " + std::to_string(info.depth) + " score " + scoreText(info.score)
+                  + " nodes " + std::to_string(info.nodes) + " nps " + std::to_string(info.nps)
+                  + " hashfull " + std::to_string(info.hashfull) + " time " + std::to_string(info.ms)
+                  + " pv";
+    for (const Move& m : info.pv) s += " " + toUci(m);
+    return s;
+}
+
+static bool isTrue(const std::string& value) {
+    return value == "true";
+}
+
+Uci::Uci(std::ostream& out) : out(out) {
+    search.setHashSize(DEFAULT_HASH_MB);
+    setFromFEN(board, STARTPOS_FEN);
+}
+
+Uci::~Uci() {
+    search.stop();
+    release();
+    wait();
+}
+
+void Uci::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outMutex);
+    out << line << std::endl; // a GUI waits for every line, never keep one buffered
+}
+
+void Uci::release() {
+    {
+        std::lock_guard<std::mutex> lock(releaseMutex);
+        mayAnswer = true;
+    }
+    released.notify_all();
+}
+
+void Uci::wait() {
+    if (searchThread.joinable()) searchThread.join();
+}
+
+void Uci::loop(std::istream& in) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!command(line)) return;
+    }
+    // end of input is a quit, but the search it started still answers
+    wait();
+}
+
+bool Uci::command(std::string_view line) {
+    std::istringstream args{std::string(line)};
+    std::string cmd;
+    if (!(args >> cmd)) return true;
+
+    if (cmd == "uci") {
+        send("id name chess_engine");
+        send("id author gabirayman");
+        send("option name Hash type spin default " + std::to_string(DEFAULT_HASH_MB) + " min 1 max 65536");
+        send("option name Threads type spin default 1 min 1 max 256");
+        send("option name Clear Hash type button");
+        send("option name Ponder type check default false");
+        send("option name EvalFile type string default <empty>");
+        send("option name NullMove type check default true");
+        send("option name LMR type check default true");
+        send("option name ReverseFutility type check default true");
+        send("option name LateMovePruning type check default true");
+        send("option name Aspiration type check default true");
+        send("option name UpcomingRepetition type check default true");
+        send("uciok");
+    } else if (cmd == "isready") {
+        send("readyok");
+    } else if (cmd == "setoption") {
+        // setoption name <id, may have spaces> [value <x, may have spaces>]
+        std::string token, name, value;
+        std::string* field = nullptr;
+        while (args >> token) {
+            if (token == "name") field = &name;
+            else if (token == "value") field = &value;
+            else if (field) *field += (field->empty() ? "" : " ") + token;
+        }
+        setOption(name, value);
+    } else if (cmd == "ucinewgame") {
+        search.stop();
+        release();
+        wait();
+        search.clearHash();
+    } else if (cmd == "position") {
+        search.stop();
+        release();
+        wait();
+        setPosition(args);
+    } else if (cmd == "go") {
+        go(args);
+    } else if (cmd == "stop") {
+        search.stop();
+        release();
+        wait();
+    } else if (cmd == "ponderhit") {
+        search.ponderhit();
+        release();
+    } else if (cmd == "quit") {
+        search.stop();
+        release();
+        wait();
+        return false;
+    } else if (cmd == "d") {
+        std::ostringstream os;
+        printBoard(board, os);
+        send(os.str() + "Fen: " + toFEN(board) + "\nKey: " + std::to_string(board.key));
+    } else {
+        send("info string unknown command: " + std::string(line));
+    }
+    return true;
+}
+
+void Uci::setOption(const std::string& name, const std::string& value) {
+    // the search reads its options at go(), none may change under a running one
+    search.stop();
+    release();
+    wait();
+
+    SearchOptions opts = search.options();
+    if (name == "Hash") {
+        search.setHashSize(static_cast<std::size_t>(std::clamp(std::atoi(value.c_str()), 1, 65536)));
+    } else if (name == "Threads") {
+        search.setThreads(std::clamp(std::atoi(value.c_str()), 1, 256));
+    } else if (name == "Clear Hash") {
+        search.clearHash();
+    } else if (name == "Ponder") {
+        // nothing to set up: the GUI decides when to send go ponder
+    } else if (name == "EvalFile") {
+        if (value.empty() || value == "<empty>") {
+            NNUE_NET = nullptr;
+            send("info string classical evaluation");
+        } else {
+            std::string error;
+            if (nnueLoad(value, &error)) send("info string network " + value + " loaded");
+            else send("info string " + error);
+        }
+        // the current position picks the evaluation up at the next search
+    } else if (name == "NullMove") {
+        opts.nullMove = isTrue(value);
+    } else if (name == "LMR") {
+        opts.lmr = isTrue(value);
+    } else if (name == "ReverseFutility") {
+        opts.reverseFutility = isTrue(value);
+    } else if (name == "LateMovePruning") {
+        opts.lateMovePruning = isTrue(value);
+    } else if (name == "Aspiration") {
+        opts.aspiration = isTrue(value);
+    } else if (name == "UpcomingRepetition") {
+        opts.upcomingRepetition = isTrue(value);
+    } else {
+        send("info string unknown option: " + name);
+    }
+    search.setOptions(opts);
+}
+
+void Uci::setPosition(std::istringstream& args) {
+    std::string token, fen;
+    args >> token;
+    if (token == "startpos") {
+        fen = STARTPOS_FEN;
+        args >> token; // "moves", if any
+    } else if (token == "fen") {
+        while (args >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+    } else {
+        send("info string position needs startpos or fen");
+        return;
+    }
+
+    Board b;
+    if (const FenResult r = parseFEN(b, fen); !r) {
+        send("info string invalid fen (" + std::string(fenErrorText(r.error)) + " at character "
+             + std::to_string(r.offset + 1) + "): " + fen);
+        return;
+    }
+    if (!b.isPlayable()) {
+        send("info string position not playable (a king missing or the side not to move in check): " + fen);
+        return;
+    }
+    board = b;
+    states.clear();
+
+    // the moves are made, not applied: their undo records stay as the game history
+    while (args >> token) {
+        Move m{};
+        if (!fromUci(board, token, m)) {
+            send("info string illegal move " + token + ", the moves from there are ignored");
+            return;
+        }
+        board.makeMove(m, states.emplace_back());
+    }
+}
+
+void Uci::go(std::istringstream& args) {
+    search.stop();
+    release();
+    wait();
+
+    SearchLimits limits;
+    std::string token;
+    while (args >> token) {
+        if (token == "depth") args >> limits.depth;
+        else if (token == "nodes") args >> limits.nodes;
+        else if (token == "movetime") args >> limits.movetime;
+        else if (token == "wtime") args >> limits.wtime;
+        else if (token == "btime") args >> limits.btime;
+        else if (token == "winc") args >> limits.winc;
+        else if (token == "binc") args >> limits.binc;
+        else if (token == "movestogo") args >> limits.movestogo;
+        else if (token == "infinite") limits.infinite = true;
+        else if (token == "ponder") limits.ponder = true;
+    }
+
+    // an infinite or ponder search keeps its bestmove until stop (or ponderhit)
+    {
+        std::lock_guard<std::mutex> lock(releaseMutex);
+        mayAnswer = !limits.infinite && !limits.ponder;
+    }
+    searchThread = std::thread([this, limits, root = board] {
+        const SearchInfo info = search.go(root, limits, [this](const SearchInfo& i) { send(infoLine(i)); });
+        {
+            std::unique_lock<std::mutex> lock(releaseMutex);
+            released.wait(lock, [this] { return mayAnswer; });
+        }
+        if (info.pv.empty()) {
+            send("bestmove 0000"); // mate or stalemate on the board
+        } else if (info.pv.size() > 1) {
+            send("bestmove " + toUci(info.pv[0]) + " ponder " + toUci(info.pv[1]));
+        } else {
+            send("bestmove " + toUci(info.pv[0]));
+        }
+    });
+}
+
+} // namespace chess
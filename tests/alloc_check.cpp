@@ -0,0 +1,71 @@
+#include "chess/board.hpp"
+#include "chess/fen.hpp"
+#include "chess/perft.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace chess;
+
+// Counting allocator: every global operator new bumps the counter,
+// so any heap traffic inside perft shows up as a non-zero delta.
+static std::atomic<std::size_t> g_allocs{0};
+
+void* operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc{};
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void  operator delete(void* p) noexcept { std::free(p); }
+void  operator delete[](void* p) noexcept { std::free(p); }
+void  operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void  operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    // same positions as tests/data/perft_cases.txt
+    const char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    };
+
+    for (const char* fen : fens) {
+        Board b;
+        if (!setFromFEN(b, fen)) {
+            std::cerr << "[BAD FEN] " << fen << "\n";
+            return 1;
+        }
+
+        const std::size_t before = g_allocs.load();
+        PerftStats s = perft_stats(b, 3);
+        const std::size_t allocs = g_allocs.load() - before;
+
+        std::cout << (allocs ? "[FAIL] " : "[PASS] ") << fen
+                  << "  nodes=" << s.nodes << "  allocations=" << allocs << "\n";
+        if (allocs) failed++;
+    }
+
+    // FEN and EPD lines are parsed in place, FENs written into a buffer
+    {
+        Board b;
+        std::string_view ops;
+        bool ok = true;
+        const std::size_t before = g_allocs.load();
+        for (const char* fen : fens) ok = ok && setFromFEN(b, fen) && setFromEPD(b, fen, &ops);
+        ok = ok && setFromEPD(b, "4k3/8/8/8/8/8/8/4K2R w K - bm e1g1; id \"castle\";", &ops);
+        ok = ok && !parseFEN(b, "4k3/8/8/8/8/8/8/4K2R w KX - 0 1");
+        char buf[FEN_MAX_LENGTH];
+        for (const char* fen : fens) ok = ok && setFromFEN(b, fen) && std::string_view(buf, writeFEN(b, buf)) == fen;
+        const std::size_t allocs = g_allocs.load() - before;
+
+        std::cout << (ok && !allocs ? "[PASS] " : "[FAIL] ") << "parseFEN/parseEPD/writeFEN  allocations=" << allocs << "\n";
+        if (!ok || allocs) failed++;
+    }
+
+    return summary();
+}
@@ -0,0 +1,191 @@
+#include "chess/batch.hpp"
+#include "chess/board.hpp"
+#include "chess/eval.hpp"
+#include "chess/fen.hpp"
+#include "chess/perft.hpp"
+#include "check.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace chess;
+
+// same positions as tests/data/perft_cases.txt, with their depth 3 counts
+static const char* FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+};
+static const std::uint64_t PERFT3[] = { 8902, 97862, 2812, 9467 };
+
+// positions of random games, enough to span several chunks of the batch
+static std::vector<std::string> randomPositions(int count) {
+    std::vector<std::string> fens;
+    std::uint64_t seed = 0x2545F4914F6CDD1DULL;
+    while (static_cast<int>(fens.size()) < count) {
+        Board b;
+        b.setStartPos();
+        std::deque<StateInfo> states;
+        for (int ply = 0; ply < 100 && static_cast<int>(fens.size()) < count; ++ply) {
+            MoveList moves;
+            b.generateLegalMoves(moves);
+            if (moves.empty()) break;
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            b.makeMove(moves[static_cast<int>((seed >> 33) % moves.size())], states.emplace_back());
+            fens.push_back(toFEN(b));
+        }
+    }
+    return fens;
+}
+
+static std::vector<std::string> lines(const std::string& text) {
+    std::vector<std::string> out;
+    std::istringstream in(text);
+    for (std::string l; std::getline(in, l);) out.push_back(l);
+    return out;
+}
+
+static std::string run(const std::string& path, const BatchOptions& opts, BatchStats* stats = nullptr) {
+    std::ostringstream out;
+    std::string error;
+    if (!runBatch(path, opts, out, stats, &error)) std::cerr << "    " << error << "\n";
+    return out.str();
+}
+
+int main() {
+    // EPD lines: clocks optional, operations returned as they are
+    {
+        Board b;
+        std::string_view ops;
+        bool ok = setFromEPD(b, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - bm e2a6; id \"kiwi\";", &ops)
+                  && ops == "bm e2a6; id \"kiwi\";" && b.halfmoveClock == 0 && b.fullmoveNumber == 1;
+        ok = ok && setFromEPD(b, "8/8/8/8/8/8/8/K6k b - - 12 40 ce 5;\r", &ops)
+                && ops == "ce 5;" && b.halfmoveClock == 12 && b.fullmoveNumber == 40;
+        ok = ok && setFromEPD(b, "8/8/8/8/8/8/8/K6k b - - 12", &ops) && ops == "12" && b.halfmoveClock == 0;
+        for (const char* fen : FENS) ok = ok && setFromEPD(b, fen, &ops) && ops.empty() && toFEN(b) == fen;
+        check(ok, "setFromEPD: four fields, optional clocks, operations");
+
+        const char* bad[] = { "", "8/8/8 w - -", "8/8/8/8/8/8/8/8/8 w - - 0 1", "9/8/8/8/8/8/8/8 w - - 0 1",
+                              "8/8/8/8/8/8/8/K6kk b - - 0 1", "8/8/8/8/8/8/8/K6k x - - 0 1",
+                              "8/8/8/8/8/8/8/K6k b - - x 1" };
+        bool rejected = true;
+        for (const char* fen : bad) rejected = rejected && !setFromFEN(b, fen);
+        check(rejected, "setFromFEN: malformed fields rejected");
+    }
+
+    const std::string path = std::filesystem::temp_directory_path().string() + "/chess_batch_check.epd";
+    const std::vector<std::string> random = randomPositions(10000);
+
+    // the perft suite as FEN and as EPD, comments, blank and bad lines, CRLF, no final newline
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << "# perft suite\n\n";
+        for (const char* fen : FENS) f << fen << "\n";
+        f << "  r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - id \"position4\";\r\n";
+        f << "not a position\n";
+        f << "8/8/8/8/8/8/8/K7 w - - 0 1\n";     // no black king
+        f << "k7/8/8/8/8/8/8/R6K w - - 0 1\n";   // black, not to move, in check
+        f << "8/8/8/8/8/8/8/K6k b - -";
+    }
+    {
+        BatchOptions opts;
+        opts.job = JOB_PERFT;
+        opts.depth = 3;
+        BatchStats stats;
+        const std::vector<std::string> out = lines(run(path, opts, &stats));
+        bool ok = out.size() == 9 && stats.positions == 9 && stats.invalid == 3;
+        for (int i = 0; ok && i < 4; ++i) {
+            ok = out[i] == std::string(FENS[i]) + " D3 " + std::to_string(PERFT3[i]) + ";";
+        }
+        ok = ok && out[4] == "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - id \"position4\"; D3 9467;";
+        ok = ok && out[5] == "not a position c0 \"invalid position\";"
+                && out[6] == "8/8/8/8/8/8/8/K7 w - - 0 1 c0 \"invalid position\";"
+                && out[7] == "k7/8/8/8/8/8/8/R6K w - - 0 1 c0 \"invalid position\";"
+                && out[8] == "8/8/8/8/8/8/8/K6k b - - D3 54;";
+        check(ok, "perft 3: suite counts, EPD line, invalid lines, in order");
+        for (const std::string& l : out) std::cout << "    " << l << "\n";
+    }
+
+    // thousands of positions: every result in its place, whatever the number of threads
+    {
+        std::ofstream f(path, std::ios::binary);
+        for (const std::string& fen : random) f << fen << "\n";
+    }
+    {
+        BatchOptions opts;
+        const std::string one = run(path, opts);
+        opts.threads = 3;
+        const std::string three = run(path, opts);
+        const std::vector<std::string> out = lines(one);
+        bool ok = out.size() == random.size();
+        for (std::size_t i = 0; ok && i < random.size(); ++i) {
+            Board b;
+            setFromFEN(b, random[i]);
+            MoveList moves;
+            b.generateLegalMoves(moves);
+            ok = out[i] == random[i] + " D1 " + std::to_string(moves.size()) + ";";
+        }
+        check(ok && one == three, "legal moves of " + std::to_string(random.size()) + " positions, 1 and 3 threads");
+
+        opts.job = JOB_EVAL;
+        const std::vector<std::string> evals = lines(run(path, opts));
+        ok = evals.size() == random.size();
+        for (std::size_t i = 0; ok && i < random.size(); ++i) {
+            Board b;
+            setFromFEN(b, random[i]);
+            ok = evals[i] == random[i] + " ce " + std::to_string(evaluate(b)) + ";";
+        }
+        check(ok, "static eval of " + std::to_string(random.size()) + " positions");
+    }
+
+    // searches: deterministic per position, so the same with more threads
+    {
+        std::ofstream f(path, std::ios::binary);
+        for (std::size_t i = 0; i < random.size(); i += 100) f << random[i] << "\n";
+    }
+    {
+        BatchOptions opts;
+        opts.job = JOB_SEARCH;
+        opts.depth = 4;
+        const std::string one = run(path, opts);
+        opts.threads = 3;
+        const std::string three = run(path, opts);
+        bool ok = one == three && lines(one).size() == random.size() / 100;
+        // a mate found early ends the search before depth 4
+        for (const std::string& l : lines(one)) ok = ok && l.find(" ce ") != std::string::npos && l.find(" acd ") != std::string::npos;
+        check(ok, "search depth 4, 1 and 3 threads agree");
+
+        opts.depth = 0;
+        opts.nodes = 2000;
+        BatchStats stats;
+        const std::string limited = run(path, opts, &stats);
+        opts.threads = 1;
+        check(limited == run(path, opts) && stats.nodes >= 2000 * stats.positions,
+              "search 2000 nodes, 1 and 3 threads agree, " + std::to_string(stats.nodes) + " nodes");
+    }
+
+    // options and files runBatch refuses
+    {
+        std::ostringstream out;
+        std::string error;
+        BatchOptions opts;
+        bool ok = !runBatch(path + ".missing", opts, out, nullptr, &error) && !error.empty();
+        opts.job = JOB_PERFT;
+        opts.depth = 0;
+        ok = ok && !runBatch(path, opts, out, nullptr, &error);
+        opts.job = JOB_SEARCH;
+        ok = ok && !runBatch(path, opts, out, nullptr, &error);
+        check(ok && out.str().empty(), "missing file, perft depth 0 and unlimited search refused");
+    }
+
+    std::remove(path.c_str());
+    return summary();
+}
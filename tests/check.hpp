@@ -0,0 +1,22 @@
+#pragma once
+// Pass/fail reporting shared by the checkers: one line per check, a summary at the end
+// and the exit code from the number of failures.
+#include <iostream>
+#include <string>
+
+inline int failed = 0;
+
+inline void check(bool ok, const std::string& what) {
+    if (ok) {
+        std::cout << "[PASS] " << what << "\n";
+    } else {
+        std::cerr << "[FAIL] " << what << "\n";
+        failed++;
+    }
+}
+
+// print the summary line; the checker's exit code
+inline int summary() {
+    std::cout << "Summary: fail=" << failed << "\n";
+    return failed ? 1 : 0;
+}
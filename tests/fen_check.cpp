@@ -0,0 +1,355 @@
+#include "chess/board.hpp"
+#include "chess/fen.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace chess;
+
+// --- reference: the iostream parser and writer writeFEN/parseFEN replaced ---
+
+namespace ref {
+
+static bool putPiece(Board& b, int sq, char c) {
+    const std::string_view chars = "PNBRQKpnbrqk";
+    const std::size_t i = chars.find(c);
+    if (i == std::string_view::npos) return false;
+    b.bb[i / PIECE_N][i % PIECE_N] |= BB(sq);
+    return true;
+}
+
+static bool setFromFEN(Board& b, std::string_view fen) {
+    for (int c = 0; c < COLOR_N; ++c)
+        for (int p = 0; p < PIECE_N; ++p)
+            b.bb[c][p] = 0ULL;
+
+    std::istringstream ss{std::string(fen)};
+    std::string board, stm, cast, ep;
+    int half = 0, full = 1;
+    if (!(ss >> board >> stm >> cast >> ep >> half >> full)) return false;
+
+    int sq = 56;
+    int filesInRank = 0;
+    for (char ch : board) {
+        if (ch == '/') {
+            if (filesInRank != 8) return false;
+            sq -= 16;
+            filesInRank = 0;
+            continue;
+        }
+        if (ch >= '0' && ch <= '9') {
+            int run = ch - '0';
+            if (run < 1 || run > 8 || filesInRank + run > 8) return false;
+            sq += run;
+            filesInRank += run;
+        } else {
+            if (!putPiece(b, sq, ch)) return false;
+            ++sq;
+            ++filesInRank;
+        }
+    }
+    if (filesInRank != 8) return false;
+
+    if (stm == "w")      b.sideToMove = WHITE;
+    else if (stm == "b") b.sideToMove = BLACK;
+    else return false;
+
+    b.castling = 0;
+    if (cast != "-") {
+        for (char c : cast) {
+            if      (c == 'K') b.castling |= CR_WK;
+            else if (c == 'Q') b.castling |= CR_WQ;
+            else if (c == 'k') b.castling |= CR_BK;
+            else if (c == 'q') b.castling |= CR_BQ;
+            else return false;
+        }
+    }
+
+    b.epTarget = 0ULL;
+    if (ep != "-") {
+        if (ep.size() != 2) return false;
+        char f = ep[0], r = ep[1];
+        if (f < 'a' || f > 'h' || r < '1' || r > '8') return false;
+        b.epTarget = BB((r - '1') * 8 + (f - 'a'));
+    }
+
+    if (half < 0 || full <= 0) return false;
+    b.halfmoveClock = half;
+    b.fullmoveNumber = full;
+    b.st = nullptr;
+    b.historyPlies = 0;
+    b.recompute();
+    return true;
+}
+
+static std::string toFEN(const Board& b) {
+    std::ostringstream out;
+    for (int r = 7; r >= 0; --r) {
+        int run = 0;
+        for (int f = 0; f < 8; ++f) {
+            const int sq = r * 8 + f;
+            const Piece p = b.mailbox[sq];
+            if (p == PIECE_N) {
+                ++run;
+                continue;
+            }
+            if (run) { out << run; run = 0; }
+            out << (b.occ[WHITE] & BB(sq) ? "PNBRQK" : "pnbrqk")[p];
+        }
+        if (run) out << run;
+        if (r) out << '/';
+    }
+    out << ' ' << (b.sideToMove == WHITE ? 'w' : 'b') << ' ';
+    std::string cast;
+    if (b.castling & CR_WK) cast += 'K';
+    if (b.castling & CR_WQ) cast += 'Q';
+    if (b.castling & CR_BK) cast += 'k';
+    if (b.castling & CR_BQ) cast += 'q';
+    out << (cast.empty() ? "-" : cast) << ' ';
+    if (b.epTarget == 0ULL) {
+        out << '-';
+    } else {
+        const int epsq = static_cast<int>(getSquare(b.epTarget));
+        out << static_cast<char>('a' + epsq % 8) << static_cast<char>('1' + epsq / 8);
+    }
+    out << ' ' << b.halfmoveClock << ' ' << b.fullmoveNumber;
+    return out.str();
+}
+
+} // namespace ref
+
+static bool sameBoard(const Board& a, const Board& b) {
+    for (int c = 0; c < COLOR_N; ++c)
+        for (int p = 0; p < PIECE_N; ++p)
+            if (a.bb[c][p] != b.bb[c][p]) return false;
+    return a.sideToMove == b.sideToMove && a.castling == b.castling && a.epTarget == b.epTarget
+        && a.halfmoveClock == b.halfmoveClock && a.fullmoveNumber == b.fullmoveNumber && a.key == b.key
+        && a.mailbox == b.mailbox;
+}
+
+static std::string write(const Board& b) {
+    char buf[FEN_MAX_LENGTH];
+    return std::string(buf, writeFEN(b, buf));
+}
+
+static U64 rng = 0x9E3779B97F4A7C15ULL;
+static U64 next() {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return rng;
+}
+
+// positions of random games (castling rights and en passant squares come and go)
+static std::vector<std::string> gamePositions(int count) {
+    std::vector<std::string> fens;
+    while (static_cast<int>(fens.size()) < count) {
+        Board b;
+        b.setStartPos();
+        std::deque<StateInfo> states;
+        for (int ply = 0; ply < 120 && static_cast<int>(fens.size()) < count; ++ply) {
+            MoveList moves;
+            b.generateLegalMoves(moves);
+            if (moves.empty()) break;
+            b.makeMove(moves[static_cast<int>(next() % moves.size())], states.emplace_back());
+            fens.push_back(ref::toFEN(b));
+        }
+    }
+    return fens;
+}
+
+// Any placement (one king each), any flags, any square for en passant, clocks up to
+// INT_MAX: the writer has to cope with all of them, not only game positions
+static std::string randomFEN() {
+    Board b;
+    for (int c = 0; c < COLOR_N; ++c)
+        for (int p = 0; p < PIECE_N; ++p)
+            b.bb[c][p] = 0ULL;
+    U64 used = 0;
+    auto place = [&](Color c, Piece p) {
+        int sq;
+        do sq = static_cast<int>(next() % 64); while (used & BB(sq));
+        used |= BB(sq);
+        b.bb[c][p] |= BB(sq);
+    };
+    place(WHITE, KING);
+    place(BLACK, KING);
+    const int pieces = static_cast<int>(next() % 31);
+    for (int i = 0; i < pieces; ++i) place(static_cast<Color>(next() & 1), static_cast<Piece>(next() % KING));
+    b.sideToMove = static_cast<Color>(next() & 1);
+    b.castling = static_cast<uint8_t>(next() & 15);
+    b.epTarget = next() & 1 ? BB(static_cast<int>(next() % 64)) : 0ULL;
+    b.halfmoveClock = next() & 1 ? static_cast<int>(next() % 100) : static_cast<int>(next() & 0x7FFFFFFF);
+    b.fullmoveNumber = 1 + static_cast<int>(next() % 0x7FFFFFFE);
+    b.st = nullptr;
+    b.historyPlies = 0;
+    b.recompute();
+    return ref::toFEN(b);
+}
+
+// one to three random edits: a character replaced, removed or inserted
+static std::string mutate(std::string s) {
+    static const std::string ALPHABET = " /0123456789KQkqPpNnBbRrw-aeh3\t+x";
+    const int edits = 1 + static_cast<int>(next() % 3);
+    for (int i = 0; i < edits; ++i) {
+        const std::size_t at = next() % (s.size() + 1);
+        const char c = ALPHABET[next() % ALPHABET.size()];
+        switch (next() % 3) {
+        case 0: if (at < s.size()) s[at] = c; break;
+        case 1: if (at < s.size()) s.erase(at, 1); break;
+        default: s.insert(at, 1, c); break;
+        }
+    }
+    return s;
+}
+
+template <class F>
+static double nsPer(std::size_t count, F&& f) {
+    double best = 1e30;
+    for (int run = 0; run < 5; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, static_cast<double>(ns) / static_cast<double>(count));
+    }
+    return best;
+}
+
+int main() {
+    // errors: the code and where the parser stopped
+    {
+        struct Case { const char* fen; FenError error; std::size_t offset; };
+        const Case cases[] = {
+            { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FEN_OK, 0 },
+            { "", FEN_MISSING_FIELD, 0 },
+            { "8/8/8/8/8/8/8/K6k w - - 0", FEN_MISSING_FIELD, 25 },
+            { "8/8/8/8/8/8/8/K6x w - - 0 1", FEN_BAD_PIECE, 16 },
+            { "8/8/8/8/8/8/8/K6k9 w - - 0 1", FEN_BAD_PIECE, 17 },
+            { "8/8/8/8/8/8/8/K7k w - - 0 1", FEN_BAD_RANK, 16 },
+            { "8/8/8/8/8/8/8/K5k w - - 0 1", FEN_BAD_RANK, 17 },
+            { "7/8/8/8/8/8/8/K6k w - - 0 1", FEN_BAD_RANK, 1 },
+            { "8/8/8/8/8/8/8/K6kk w - - 0 1", FEN_BAD_RANK, 17 },
+            { "8/8/8/8/8/8/K6k w - - 0 1", FEN_BAD_RANK_COUNT, 15 },
+            { "8/8/8/8/8/8/8/8/K6k w - - 0 1", FEN_BAD_RANK_COUNT, 15 },
+            { "8/8/8/8/8/8/8/K6k x - - 0 1", FEN_BAD_SIDE, 18 },
+            { "8/8/8/8/8/8/8/K6k white - - 0 1", FEN_BAD_SIDE, 18 },
+            { "8/8/8/8/8/8/8/K6k b KQx - 0 1", FEN_BAD_CASTLING, 22 },
+            { "8/8/8/8/8/8/8/K6k b - e9 0 1", FEN_BAD_EP, 22 },
+            { "8/8/8/8/8/8/8/K6k b - e33 0 1", FEN_BAD_EP, 22 },
+            { "8/8/8/8/8/8/8/K6k b - - -1 1", FEN_BAD_HALFMOVE, 24 },
+            { "8/8/8/8/8/8/8/K6k b - - 1x 1", FEN_BAD_HALFMOVE, 24 },
+            { "8/8/8/8/8/8/8/K6k b - - 3 0", FEN_BAD_FULLMOVE, 26 },
+            { "8/8/8/8/8/8/8/K6k b - - 3 99999999999", FEN_BAD_FULLMOVE, 26 },
+        };
+        bool ok = true;
+        for (const Case& c : cases) {
+            Board b;
+            b.setStartPos();
+            const FenResult r = parseFEN(b, c.fen);
+            const bool good = r.error == c.error && r.offset == c.offset
+                              && (r || toFEN(b) == STARTPOS_FEN); // untouched on error
+            if (!good) {
+                std::cerr << "    \"" << c.fen << "\": " << fenErrorText(r.error) << " at " << r.offset
+                          << ", expected " << fenErrorText(c.error) << " at " << c.offset << "\n";
+            }
+            ok = ok && good;
+        }
+        check(ok, "parseFEN: error codes and offsets, board untouched on error");
+    }
+
+    const std::vector<std::string> games = gamePositions(20000);
+    std::vector<std::string> fens = games;
+    for (int i = 0; i < 20000; ++i) fens.push_back(randomFEN());
+
+    // writer and parser against the reference, both ways
+    {
+        bool ok = true;
+        std::size_t longest = 0;
+        for (const std::string& fen : fens) {
+            Board a, b;
+            const bool parsed = setFromFEN(a, fen) && ref::setFromFEN(b, fen) && sameBoard(a, b);
+            const std::string out = write(a);
+            longest = std::max(longest, out.size());
+            if (!parsed || out != fen || out != ref::toFEN(b) || toFEN(a) != fen) {
+                std::cerr << "    " << fen << " -> " << out << "\n";
+                ok = false;
+                break;
+            }
+        }
+        check(ok, "round trip of " + std::to_string(fens.size()) + " game and random positions, longest FEN "
+                  + std::to_string(longest) + " of " + std::to_string(FEN_MAX_LENGTH));
+    }
+
+    // buffers of every size: the whole FEN or nothing
+    {
+        Board b;
+        setFromFEN(b, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 2147483647 2147483647");
+        const std::string fen = write(b);
+        bool ok = true;
+        for (std::size_t size = 0; size <= FEN_MAX_LENGTH + 1; ++size) {
+            std::vector<char> buf(size + 1, '#');
+            const std::size_t n = writeFEN(b, std::span<char>(buf.data(), size));
+            ok = ok && buf[size] == '#'
+                    && (size < fen.size() ? n == 0 : n == fen.size() && std::string(buf.data(), n) == fen);
+        }
+        check(ok, "writeFEN into spans of 0.." + std::to_string(FEN_MAX_LENGTH + 1) + " chars");
+    }
+
+    // mutated FENs: whatever the new parser takes, the reference reads the same way;
+    // whatever it refuses leaves the board alone and points inside the text
+    {
+        bool ok = true;
+        int accepted = 0, rejected = 0;
+        for (int i = 0; i < 200000 && ok; ++i) {
+            const std::string s = mutate(fens[next() % fens.size()]);
+            Board b;
+            b.setStartPos();
+            const FenResult r = parseFEN(b, s);
+            if (r) {
+                Board a;
+                Board again;
+                ok = ref::setFromFEN(a, s) && sameBoard(a, b) && setFromFEN(again, write(b)) && sameBoard(again, b);
+                ++accepted;
+            } else {
+                ok = r.offset <= s.size() && toFEN(b) == STARTPOS_FEN;
+                ++rejected;
+            }
+            if (!ok) std::cerr << "    \"" << s << "\": " << fenErrorText(r.error) << " at " << r.offset << "\n";
+        }
+        check(ok, "200000 mutated FENs: " + std::to_string(accepted) + " read as the reference does, "
+                  + std::to_string(rejected) + " refused cleanly");
+    }
+
+    // speed against the reference
+    {
+        std::vector<Board> boards(games.size());
+        for (std::size_t i = 0; i < games.size(); ++i) setFromFEN(boards[i], games[i]);
+        std::size_t sink = 0;
+        const double refWrite = nsPer(boards.size(), [&] {
+            for (const Board& b : boards) sink += ref::toFEN(b).size();
+        });
+        const double newWrite = nsPer(boards.size(), [&] {
+            char buf[FEN_MAX_LENGTH];
+            for (const Board& b : boards) sink += writeFEN(b, buf);
+        });
+        Board b;
+        const double refParse = nsPer(games.size(), [&] {
+            for (const std::string& fen : games) sink += ref::setFromFEN(b, fen);
+        });
+        const double newParse = nsPer(games.size(), [&] {
+            for (const std::string& fen : games) sink += static_cast<bool>(parseFEN(b, fen));
+        });
+        std::cout << "    write: reference " << refWrite << " ns, writeFEN " << newWrite << " ns\n"
+                  << "    parse: reference " << refParse << " ns, parseFEN " << newParse << " ns"
+                  << (sink ? "" : " ") << "\n";
+        check(newWrite < refWrite && newParse < refParse, "writeFEN and parseFEN faster than the iostream versions");
+    }
+
+    return summary();
+}
@@ -0,0 +1,244 @@
+#include "chess/board.hpp"
+#include "chess/debug.hpp"
+#include "chess/eval.hpp"
+#include "chess/fen.hpp"
+#include "chess/nnue.hpp"
+#include "chess/search.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace chess;
+
+static const char* FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+};
+
+// Random network in the documented file layout (there is no trained one in the tree).
+// Magnitudes keep the accumulator and the hidden layers well inside their ranges.
+static void writeNetwork(const std::string& path, std::uint32_t version, std::size_t truncate = 0) {
+    U64 s = 0x243F6A8885A308D3ULL;
+    auto next = [&s](int lo, int hi) {
+        s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+        return lo + static_cast<int>(s % static_cast<U64>(hi - lo + 1));
+    };
+
+    std::vector<char> bytes;
+    auto put = [&bytes](const auto& v) {
+        const char* p = reinterpret_cast<const char*>(&v);
+        bytes.insert(bytes.end(), p, p + sizeof(v));
+    };
+
+    NnueFileHeader h{};
+    std::copy(NNUE_MAGIC, NNUE_MAGIC + 4, h.magic);
+    h.version = version;
+    h.inputs = NNUE_INPUTS;
+    h.l1 = NNUE_L1;
+    h.l2 = NNUE_L2;
+    h.l3 = NNUE_L3;
+    put(h);
+    for (int i = 0; i < NNUE_INPUTS * NNUE_L1; ++i) put(static_cast<std::int16_t>(next(-24, 24)));
+    for (int i = 0; i < NNUE_L1; ++i) put(static_cast<std::int16_t>(next(0, 96)));
+    for (int i = 0; i < 2 * NNUE_L1 * NNUE_L2; ++i) put(static_cast<std::int8_t>(next(-40, 40)));
+    for (int i = 0; i < NNUE_L2; ++i) put(static_cast<std::int32_t>(next(-2000, 4000)));
+    for (int i = 0; i < NNUE_L2 * NNUE_L3; ++i) put(static_cast<std::int8_t>(next(-64, 64)));
+    for (int i = 0; i < NNUE_L3; ++i) put(static_cast<std::int32_t>(next(-1000, 3000)));
+    for (int i = 0; i < NNUE_L3; ++i) put(static_cast<std::int8_t>(next(-127, 127)));
+    put(static_cast<std::int32_t>(0));
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - truncate));
+}
+
+// make/unmake every move down to depth, comparing all accumulators with a recompute at
+// every node, or only at the leaves so that the accumulators are replayed over several moves
+static bool verifyTree(Board& b, int depth, std::uint64_t& nodes, bool everyNode = true) {
+    MoveList moves;
+    b.generateLegalMoves(moves);
+    StateInfo st;
+    for (const auto& mv : moves) {
+        b.makeMove(mv, st);
+        nodes++;
+        bool ok = depth <= 1 ? checkIncremental(b, std::cerr)
+                             : (!everyNode || checkIncremental(b, std::cerr)) && verifyTree(b, depth - 1, nodes, everyNode);
+        b.unmakeMove(mv);
+        if (!ok || (everyNode && !checkIncremental(b, std::cerr))) return false;
+    }
+    return true;
+}
+
+// evaluation of every node of the tree, in visiting order
+static void collectEvals(Board& b, int depth, std::vector<int>& out) {
+    out.push_back(evaluate(b));
+    if (depth == 0) return;
+    MoveList moves;
+    b.generateLegalMoves(moves);
+    StateInfo st;
+    for (const auto& mv : moves) {
+        b.makeMove(mv, st);
+        collectEvals(b, depth - 1, out);
+        b.unmakeMove(mv);
+    }
+}
+
+// nodes and time (microseconds) of a fixed-depth search of one position, fresh table each time
+static std::pair<std::uint64_t, std::int64_t> timedSearch(Search& search, const char* fen, int depth) {
+    SearchLimits limits;
+    limits.depth = depth;
+    Board b;
+    setFromFEN(b, fen);
+    search.clearHash();
+    // a depth-6 search takes a few milliseconds: SearchInfo::ms is too coarse to compare
+    const auto start = std::chrono::steady_clock::now();
+    const SearchInfo info = search.go(b, limits);
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return { info.nodes, us };
+}
+
+int main() {
+    const std::string dir = std::filesystem::temp_directory_path().string();
+    const std::string good = dir + "/chess_nnue_check.nnue";
+    const std::string badVersion = dir + "/chess_nnue_check_v2.nnue";
+    const std::string truncated = dir + "/chess_nnue_check_short.nnue";
+    writeNetwork(good, NNUE_VERSION);
+    writeNetwork(badVersion, NNUE_VERSION + 1);
+    writeNetwork(truncated, NNUE_VERSION, 100);
+
+    std::cout << "kernels in use: " << NNUE_KERNELS->name << "\n";
+
+    // files the loader must refuse, leaving the classical evaluation in place
+    {
+        std::string error;
+        const bool v = nnueLoad(badVersion, &error);
+        std::cout << "    " << error << "\n";
+        check(!v && NNUE_NET == nullptr, "wrong version rejected");
+        const bool t = nnueLoad(truncated, &error);
+        std::cout << "    " << error << "\n";
+        check(!t && NNUE_NET == nullptr, "truncated file rejected");
+        check(!nnueLoad(dir + "/no_such_file.nnue", &error), "missing file rejected");
+    }
+
+    std::string error;
+    check(nnueLoad(good, &error), "load " + good + " " + error);
+    if (!NNUE_NET) {
+        return summary();
+    }
+
+    // incremental accumulators against a full refresh, at every node
+    for (const char* fen : FENS) {
+        Board b;
+        setFromFEN(b, fen);
+        std::uint64_t nodes = 0;
+        const bool ok = b.accNet == NNUE_NET && verifyTree(b, 3, nodes);
+        check(ok, "incremental accumulator, depth 3, " + std::to_string(nodes) + " nodes: " + fen);
+    }
+
+    // accumulators only asked for at the leaves, then back at the root
+    for (const char* fen : FENS) {
+        Board b;
+        setFromFEN(b, fen);
+        std::uint64_t nodes = 0;
+        const bool ok = verifyTree(b, 4, nodes, false) && checkIncremental(b, std::cerr);
+        check(ok, "lazy accumulator, depth 4 leaves, " + std::to_string(nodes) + " nodes: " + fen);
+    }
+
+    // a line longer than the replay limit, evaluated only at its end
+    {
+        Board b;
+        setFromFEN(b, FENS[0]);
+        StateInfo st[40];
+        Move line[40];
+        int plies = 0;
+        for (; plies < 40; ++plies) {
+            MoveList moves;
+            b.generateLegalMoves(moves);
+            if (moves.size() == 0) break;
+            line[plies] = moves[plies % moves.size()];
+            b.makeMove(line[plies], st[plies]);
+        }
+        bool ok = checkIncremental(b, std::cerr);
+        while (plies > 0) b.unmakeMove(line[--plies]);
+        ok = ok && checkIncremental(b, std::cerr);
+        check(ok, "lazy accumulator after a 40-ply line");
+    }
+
+    // every kernel set the CPU supports gives the scalar result exactly
+    {
+        const NnueKernels* inUse = NNUE_KERNELS;
+        std::vector<std::vector<int>> reference;
+        NNUE_KERNELS = nnueKernels("scalar");
+        for (const char* fen : FENS) {
+            Board b;
+            setFromFEN(b, fen);
+            reference.emplace_back();
+            collectEvals(b, 2, reference.back());
+        }
+        for (const char* name : { "sse41", "avx2", "avxvnni" }) {
+            NNUE_KERNELS = nnueKernels(name);
+            if (!NNUE_KERNELS) {
+                std::cout << "    " << name << " not supported here, skipped\n";
+                continue;
+            }
+            bool same = true;
+            for (std::size_t i = 0; i < std::size(FENS); ++i) {
+                Board b;
+                setFromFEN(b, FENS[i]);
+                std::vector<int> evals;
+                collectEvals(b, 2, evals);
+                same = same && evals == reference[i];
+            }
+            check(same, std::string(name) + " kernels match scalar");
+        }
+        NNUE_KERNELS = inUse;
+    }
+
+    // the network must not cost more than half the search speed. The machine may be
+    // shared, so the two evaluations alternate position by position and each keeps its
+    // fastest of five runs.
+    {
+        const NnueNetwork* net = NNUE_NET;
+        Search search;
+        std::uint64_t nodes[2] = {0, 0};
+        std::int64_t us[2] = {0, 0};
+        for (const char* fen : FENS) {
+            std::int64_t best[2] = {INT64_MAX, INT64_MAX};
+            for (int run = 0; run < 5; ++run) {
+                for (int withNet = 0; withNet < 2; ++withNet) {
+                    NNUE_NET = withNet ? net : nullptr;
+                    const auto [n, t] = timedSearch(search, fen, 6);
+                    if (run == 0) nodes[withNet] += n;
+                    best[withNet] = std::min(best[withNet], t);
+                }
+            }
+            us[0] += best[0];
+            us[1] += best[1];
+        }
+        NNUE_NET = net;
+        const double classicalNps = static_cast<double>(nodes[0]) * 1e6 / static_cast<double>(std::max<std::int64_t>(us[0], 1));
+        const double nnueNps = static_cast<double>(nodes[1]) * 1e6 / static_cast<double>(std::max<std::int64_t>(us[1], 1));
+        const double ratio = classicalNps / nnueNps;
+        std::cout << "    search nps: classical " << static_cast<std::uint64_t>(classicalNps)
+                  << ", nnue (" << NNUE_KERNELS->name << ") " << static_cast<std::uint64_t>(nnueNps)
+                  << ", slowdown " << static_cast<int>(ratio * 100) / 100.0 << "x\n";
+        check(ratio <= 2.0, "nnue search within 2x of classical nps");
+    }
+
+    std::remove(good.c_str());
+    std::remove(badVersion.c_str());
+    std::remove(truncated.c_str());
+
+    return summary();
+}
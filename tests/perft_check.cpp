@@ -1,6 +1,8 @@
 #include "chess/board.hpp"
+#include "chess/debug.hpp"
 #include "chess/fen.hpp"
 #include "chess/perft.hpp"
+#include "chess/thread_pool.hpp"
 
 #include <cctype>
 #include <fstream> 
@@ -9,6 +11,7 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <memory>
 
 using namespace chess;
 
@@ -26,7 +29,15 @@ struct Case {
 static void usage() {
     std::cout <<
 "Usage:\n"
-"  perft_check --file tests/data/perft_cases.txt --depth 4\n";
+"  perft_check --file tests/data/perft_cases.txt --depth 4\n"
+"Options:\n"
+"  --time     print time, nodes and nps per depth\n"
+"  --hash N   cache subtree counts in an N MB perft hash table (cleared per depth)\n"
+"  --mode M   stats (default): full breakdown, nodes: bulk node count only, both: run and time both\n"
+"  --threads N  split the tree over N worker threads (work-stealing pool)\n"
+"  --scaling  after the checks, time --depth on 1/2/4/8/16 threads per case\n"
+"  --verify   also walk the tree to --depth and compare incremental state\n"
+"             (occupancy, mailbox, Zobrist key, eval accumulators) with a full recompute at every node\n";
 }
 
 // Trim helpers
@@ -43,6 +54,29 @@ static bool hasFlag(const std::vector<std::string>& args, const std::string& key
 }
 
 
+// make/unmake every move down to depth, checking incremental state after each make and unmake
+static bool verify_tree(Board& b, int depth, std::uint64_t& nodes) {
+    MoveList moves;
+    b.generateLegalMoves(moves);
+    StateInfo st;
+    for (const auto& mv : moves) {
+        b.makeMove(mv, st);
+        nodes++;
+        if (!checkIncremental(b, std::cerr)) {
+            std::cerr << "  after " << toUci(mv) << "\n";
+            return false;
+        }
+        bool ok = depth <= 1 || verify_tree(b, depth - 1, nodes);
+        b.unmakeMove(mv);
+        if (!ok) return false;
+        if (!checkIncremental(b, std::cerr)) {
+            std::cerr << "  after undoing " << toUci(mv) << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
 static bool parse_file(const std::string& path, std::vector<Case>& out) {
     std::ifstream in(path);
     if (!in) return false;
@@ -92,19 +126,36 @@ static bool parse_file(const std::string& path, std::vector<Case>& out) {
 
 int main(int argc, char** argv) {
     std::vector<std::string> args(argv + 1, argv + argc);
-    std::string filePath, depthStr;
+    std::string filePath, depthStr, hashStr, threadsStr, mode = "stats";
 
     bool timing = hasFlag(args, "--time");
+    bool verify = hasFlag(args, "--verify");
+    bool scaling = hasFlag(args, "--scaling");
 
     for (size_t i = 0; i + 1 < args.size(); ++i) {
         if (args[i] == "--file")  filePath = args[i + 1];
         if (args[i] == "--depth") depthStr = args[i + 1];
+        if (args[i] == "--hash")  hashStr = args[i + 1];
+        if (args[i] == "--threads") threadsStr = args[i + 1];
+        if (args[i] == "--mode")  mode = args[i + 1];
     }
-    if (filePath.empty() || depthStr.empty()) {
+    if (filePath.empty() || depthStr.empty() || (mode != "stats" && mode != "nodes" && mode != "both")) {
         usage();
         return 1;
     }
     int maxDepth = std::stoi(depthStr);
+    const bool runStats = mode != "nodes";
+    const bool runNodes = mode != "stats";
+
+    std::unique_ptr<PerftHash> hash;
+    if (!hashStr.empty()) {
+        hash = std::make_unique<PerftHash>(std::stoul(hashStr));
+        if (timing) std::cout << "perft hash: " << hash->entries() << " entries\n";
+    }
+
+    const int threads = threadsStr.empty() ? 1 : std::stoi(threadsStr);
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 1) pool = std::make_unique<ThreadPool>(threads);
 
     std::vector<Case> cases;
     if (!parse_file(filePath, cases)) {
@@ -126,30 +177,72 @@ int main(int argc, char** argv) {
         std::vector<PerftStats> exp(maxDepth + 1);
         std::vector<bool>       has(maxDepth + 1, false);
         for (const auto& r : c.rows) {
-            if (1 <= r.depth && r.depth <= maxDepth) {
+            if (0 <= r.depth && r.depth <= maxDepth) {
                 exp[r.depth] = r.stats;
                 has[r.depth] = true;
             }
         }
 
         bool ok = true;
-        for (int d = 1; d <= maxDepth; ++d) {
+        if (verify) {
+            Board work = b;
+            std::uint64_t nodes = 0;
+            if (!checkIncremental(work, std::cerr) || !verify_tree(work, maxDepth, nodes)) {
+                ok = false;
+                std::cerr << "[FAIL] " << (c.name.empty() ? "<noname>" : c.name)
+                          << " incremental state diverged from recompute\n";
+            } else {
+                std::cout << "  verified incremental state at " << nodes << " nodes\n";
+            }
+        }
+
+        for (int d = 0; d <= maxDepth; ++d) {
             if (!has[d]) continue; // no expectations for this depth, skip
 
-            auto t0 = std::chrono::steady_clock::now();
-            PerftStats got = perft_stats(b, d);
-            auto t1 = std::chrono::steady_clock::now();
+            const auto& e  = exp[d];
 
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-            if (timing) {
+            auto report = [&](const char* label, long long ms, std::uint64_t nodes) {
+                if (!timing) return;
                 double sec = ms / 1000.0;
-                double nps = (sec > 0.0) ? (static_cast<double>(got.nodes) / sec) : 0.0;
-                std::cout << "  D" << d << ": " << ms << " ms"
-                        << "  nodes=" << got.nodes
-                        << "  nps=" << static_cast<long long>(nps) << "\n";
+                double nps = (sec > 0.0) ? (static_cast<double>(nodes) / sec) : 0.0;
+                std::cout << "  D" << d << label << ": " << ms << " ms"
+                        << "  nodes=" << nodes
+                        << "  nps=" << static_cast<long long>(nps);
+                if (hash) {
+                    const double probes = static_cast<double>(hash->probes.load());
+                    const double rate = probes > 0.0 ? 100.0 * static_cast<double>(hash->hits.load()) / probes : 0.0;
+                    std::cout << "  hash hits=" << hash->hits.load() << "/" << hash->probes.load()
+                              << " (" << static_cast<int>(rate * 10) / 10.0 << "%)";
+                }
+                std::cout << "\n";
+            };
+
+            if (runNodes) {
+                if (hash) hash->clear(); // every run starts cold so timings stay comparable
+
+                auto t0 = std::chrono::steady_clock::now();
+                std::uint64_t nodes = pool ? perft_nodes_parallel(b, d, *pool, hash.get())
+                                           : perft_nodes(b, d, hash.get());
+                auto t1 = std::chrono::steady_clock::now();
+                report(" (nodes only)", std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count(), nodes);
+
+                if (nodes != e.nodes) {
+                    ok = false;
+                    std::cerr << "[FAIL] " << (c.name.empty() ? "<noname>" : c.name)
+                              << " D" << d << " (nodes only)\n"
+                              << "  expected: N=" << e.nodes << "\n"
+                              << "  got:      N=" << nodes << "\n";
+                }
             }
+            if (!runStats) continue;
 
-            const auto& e  = exp[d];
+            if (hash) hash->clear();
+
+            auto t0 = std::chrono::steady_clock::now();
+            PerftStats got = pool ? perft_stats_parallel(b, d, *pool, hash.get())
+                                  : perft_stats(b, d, hash.get());
+            auto t1 = std::chrono::steady_clock::now();
+            report("", std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count(), got.nodes);
 
             bool thisDepthOk =
                 got.nodes      == e.nodes      &&
@@ -181,6 +274,29 @@ int main(int argc, char** argv) {
             }
         }
 
+        if (scaling && has[maxDepth]) {
+            long long baseMs = 0;
+            for (int t : {1, 2, 4, 8, 16}) {
+                ThreadPool scalePool(t);
+                if (hash) hash->clear();
+
+                auto t0 = std::chrono::steady_clock::now();
+                std::uint64_t nodes = runStats ? perft_stats_parallel(b, maxDepth, scalePool, hash.get()).nodes
+                                               : perft_nodes_parallel(b, maxDepth, scalePool, hash.get());
+                auto t1 = std::chrono::steady_clock::now();
+
+                long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+                if (t == 1) baseMs = ms;
+                double nps = ms > 0 ? static_cast<double>(nodes) * 1000.0 / static_cast<double>(ms) : 0.0;
+                double speedup = ms > 0 ? static_cast<double>(baseMs) / static_cast<double>(ms) : 0.0;
+                std::cout << "  scaling D" << maxDepth << " threads=" << t << ": " << ms << " ms"
+                          << "  nps=" << static_cast<long long>(nps)
+                          << "  speedup=" << static_cast<int>(speedup * 100) / 100.0 << "x"
+                          << (nodes == exp[maxDepth].nodes ? "" : "  [NODE MISMATCH]") << "\n";
+                if (nodes != exp[maxDepth].nodes) ok = false;
+            }
+        }
+
         if (ok) {
             passed++;
             std::cout << "[PASS] " << (c.name.empty() ? "<noname>" : c.name) << "\n";
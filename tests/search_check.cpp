@@ -0,0 +1,304 @@
+#include "chess/board.hpp"
+#include "chess/fen.hpp"
+#include "chess/movepick.hpp"
+#include "chess/perft.hpp"
+#include "chess/search.hpp"
+#include "chess/tt.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace chess;
+
+struct SearchCase {
+    const char* name;
+    const char* fen;
+    int depth;
+    const char* best; // expected best move in UCI text, "" = no legal move
+};
+
+static void printInfo(const SearchInfo& info) {
+    std::cout << "    depth " << info.depth << "  score " << info.score
+              << "  nodes " << info.nodes << "  " << info.ms << " ms  nps " << info.nps << "  pv";
+    for (const Move& m : info.pv) std::cout << ' ' << toUci(m);
+    if (info.cutoffs) std::cout << "  first-move cutoffs " << info.firstMoveCutoffs * 100 / info.cutoffs << "%";
+    std::cout << "\n";
+}
+
+// the picker must hand out every legal move exactly once, whatever hash move and
+// killers it is given (here: moves of the parent position, often illegal in the child)
+static bool pickerComplete(Board& b, int depth, const Move& stale, std::uint64_t& nodes) {
+    MoveList legal;
+    b.generateLegalMoves(legal);
+    nodes++;
+
+    static ButterflyHistory history = {};
+    const Move killers[2] = { stale, legal.empty() ? Move{} : legal[legal.size() - 1] };
+    MovePicker picker(b, stale != Move{} ? packMove(stale) : 0, killers, stale, history[b.sideToMove], nullptr);
+    std::vector<Move> picked;
+    Move m;
+    while (picker.next(m)) picked.push_back(m);
+
+    auto order = [](const Move& x, const Move& y) {
+        return x.raw() < y.raw();
+    };
+    std::vector<Move> expected(legal.begin(), legal.end());
+    std::sort(picked.begin(), picked.end(), order);
+    std::sort(expected.begin(), expected.end(), order);
+    if (picked != expected) {
+        std::cerr << "    picker differs in " << toFEN(b) << "\n";
+        return false;
+    }
+
+    if (depth == 0) return true;
+    StateInfo st;
+    for (const Move& mv : legal) {
+        b.makeMove(mv, st);
+        const bool ok = pickerComplete(b, depth - 1, legal[0], nodes);
+        b.unmakeMove(mv);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// make the moves of text (UCI, space separated), their records stay in states
+static void play(Board& b, std::deque<StateInfo>& states, const std::string& text) {
+    std::istringstream words(text);
+    std::string word;
+    while (words >> word) {
+        Move m{};
+        if (!fromUci(b, word, m)) {
+            std::cerr << "    illegal move " << word << " in " << toFEN(b) << "\n";
+            return;
+        }
+        b.makeMove(m, states.emplace_back());
+    }
+}
+
+// a random walk of quiet moves: at every step the cuckoo test must find an upcoming
+// repetition exactly when some legal move repeats a position of the history (the whole
+// walk counts as search, so one earlier occurrence is enough)
+static bool cuckooMatchesMoves(const char* fen, int plies, int& found) {
+    Board b;
+    setFromFEN(b, fen);
+    std::deque<StateInfo> states;
+    std::uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < plies; ++i) {
+        MoveList list;
+        b.generateLegalMoves(list);
+        bool repeats = false;
+        StateInfo st;
+        for (const Move& m : list) {
+            b.makeMove(m, st);
+            repeats = repeats || b.isRepetition(plies + 1);
+            b.unmakeMove(m);
+        }
+        if (repeats != b.hasUpcomingRepetition(plies)) {
+            std::cerr << "    cuckoo says " << !repeats << " after " << i << " plies: " << toFEN(b) << "\n";
+            return false;
+        }
+        found += repeats;
+
+        MoveList quiets;
+        b.generateLegalMoves(quiets, GEN_QUIETS);
+        // the walk may run into a mate, then start it over
+        if (quiets.empty()) {
+            setFromFEN(b, fen);
+            continue;
+        }
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        b.makeMove(quiets[static_cast<int>((seed >> 33) % quiets.size())], states.emplace_back());
+    }
+    return true;
+}
+
+// fixed suite for the thread scaling benchmark
+static const char* SCALING_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8",
+    "2r3k1/pp3ppp/4p3/3pP3/3P1P2/P1r5/1P4PP/2R2RK1 w - - 0 24",
+};
+
+// time to reach a fixed depth on the suite with 1/2/4/8/16 threads (fresh table each time)
+static void scaling(int depth) {
+    long long baseMs = 0;
+    for (int t : {1, 2, 4, 8, 16}) {
+        Search search;
+        search.setThreads(t);
+        SearchLimits limits;
+        limits.depth = depth;
+
+        long long ms = 0;
+        std::uint64_t nodes = 0;
+        for (const char* fen : SCALING_FENS) {
+            Board b;
+            setFromFEN(b, fen);
+            search.clearHash();
+            auto t0 = std::chrono::steady_clock::now();
+            nodes += search.go(b, limits).nodes;
+            ms += std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+        }
+        if (t == 1) baseMs = ms;
+        const double speedup = ms > 0 ? static_cast<double>(baseMs) / static_cast<double>(ms) : 0.0;
+        std::cout << "  scaling depth " << depth << " threads=" << t << ": " << ms << " ms"
+                  << "  nodes=" << nodes
+                  << "  nps=" << (ms > 0 ? nodes * 1000 / static_cast<std::uint64_t>(ms) : 0)
+                  << "  speedup=" << static_cast<int>(speedup * 100) / 100.0 << "x\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    bool runScaling = false;
+    int scalingDepth = 7;
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--scaling") runScaling = true;
+        if (args[i] == "--depth" && i + 1 < args.size()) scalingDepth = std::stoi(args[i + 1]);
+    }
+
+    const SearchCase cases[] = {
+        { "back rank mate in 1", "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1", 2, "d1d8" },
+        { "scholar's mate",      "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4", 2, "h5f7" },
+        { "mate in 2 (Ra6)",     "kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1", 4, "a1a6" },
+        { "win the queen",       "4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1", 3, "d1d5" },
+        { "checkmated",          "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3", 3, "" },
+    };
+
+    Search search;
+
+    // the same tactics single-threaded and with helper threads (Lazy SMP)
+    for (int threads : {1, 4}) {
+        search.setThreads(threads);
+        search.clearHash();
+        for (const auto& c : cases) {
+            Board b;
+            if (!setFromFEN(b, c.fen)) {
+                std::cerr << "[BAD FEN] " << c.name << "\n";
+                failed++;
+                continue;
+            }
+            std::cout << c.name << " (" << threads << " thread" << (threads > 1 ? "s" : "") << ")\n";
+
+            SearchLimits limits;
+            limits.depth = c.depth;
+            SearchInfo info = search.go(b, limits, printInfo);
+
+            const std::string got = info.pv.empty() ? "" : toUci(info.pv[0]);
+            if (got == c.best) {
+                std::cout << "[PASS] " << c.name << "\n";
+            } else {
+                std::cerr << "[FAIL] " << c.name << "  expected '" << c.best << "' got '" << got << "'\n";
+                failed++;
+            }
+        }
+    }
+
+    for (const char* fen : SCALING_FENS) {
+        Board b;
+        setFromFEN(b, fen);
+        std::uint64_t nodes = 0;
+        if (pickerComplete(b, 3, Move{}, nodes)) {
+            std::cout << "[PASS] move picker, depth 3, " << nodes << " nodes: " << fen << "\n";
+        } else {
+            std::cerr << "[FAIL] move picker: " << fen << "\n";
+            failed++;
+        }
+    }
+
+    // draws by rule, on the board
+    {
+        Board b;
+        b.setStartPos();
+        std::deque<StateInfo> states;
+        play(b, states, "g1f3 g8f6 f3g1 f6g8");
+        check(!b.isRepetition(0) && !b.isRepetition(4) && b.isRepetition(5) && b.state() == PLAYING,
+               "twofold: a draw only inside the search (less than ply plies ago)");
+        check(b.hasUpcomingRepetition(5) && !b.hasUpcomingRepetition(3), "upcoming repetition: g1f3 comes back");
+        play(b, states, "g1f3 g8f6 f3g1 f6g8");
+        check(b.isRepetition(0) && b.state() == REPETITION, "threefold repetition");
+        // the same position again, white to move, but through two passes
+        StateInfo nullSt[2];
+        play(b, states, "g1f3 g8f6");
+        b.makeNullMove(nullSt[0]);
+        play(b, states, "f6g8 f3g1");
+        b.makeNullMove(nullSt[1]);
+        check(!b.isRepetition(MAX_PLY) && !b.hasUpcomingRepetition(MAX_PLY), "no repetition across a null move");
+
+        Board fifty;
+        setFromFEN(fifty, "k7/8/8/8/8/8/8/4KQ2 w - - 100 80");
+        check(fifty.isFiftyMoveDraw() && fifty.state() == FIFTY_MOVES, "fifty-move rule at halfmove clock 100");
+        setFromFEN(fifty, "k7/8/8/8/8/8/8/4KQ2 w - - 99 80");
+        check(!fifty.isFiftyMoveDraw(), "not at 99");
+        setFromFEN(fifty, "k7/1Q6/1K6/8/8/8/8/8 b - - 100 80");
+        check(!fifty.isFiftyMoveDraw() && fifty.state() == CHECKMATE, "a mate beats the fifty-move rule");
+
+        const char* walks[] = {
+            "4k3/8/8/8/8/8/8/RN2K1NR w - - 0 1",
+            "r1b1k2r/8/2n2q2/8/8/2N2Q2/8/R1B1K2R w - - 0 1",
+            "3qk3/3r4/8/8/8/8/3R4/3QK3 w - - 0 1",
+        };
+        for (const char* fen : walks) {
+            int found = 0;
+            const bool same = cuckooMatchesMoves(fen, 400, found);
+            check(same && found > 0,
+                   "cuckoo test = legal repeating moves, " + std::to_string(found) + " found: " + fen);
+        }
+
+        // the search: at clock 99 every move of the queen draws, however far ahead it is
+        search.setThreads(1);
+        search.clearHash();
+        SearchLimits limits;
+        limits.depth = 4;
+        setFromFEN(fifty, "k7/8/8/8/8/8/8/4KQ2 w - - 99 80");
+        check(search.go(fifty, limits).score == 0, "search: fifty-move draw scores 0");
+
+        // the side a queen down repeats the game position a third time
+        Board rep;
+        std::deque<StateInfo> repStates;
+        setFromFEN(rep, "4k1n1/8/8/8/8/8/8/QN2K3 w - - 0 1");
+        play(rep, repStates, "b1c3 g8f6 c3b1 f6g8 b1c3 g8f6 c3b1");
+        const SearchInfo info = search.go(rep, limits);
+        check(info.score == 0 && !info.pv.empty() && toUci(info.pv[0]) == "f6g8",
+               "search: claims the threefold repetition, score " + std::to_string(info.score));
+        setFromFEN(rep, "4k1n1/8/8/8/8/8/8/QN2K3 w - - 0 1");
+        repStates.clear();
+        play(rep, repStates, "b1c3 g8f6 c3b1");
+        check(search.go(rep, limits).score < -500, "search: no draw from a twofold before the root");
+    }
+
+    // the hard budget must hold on an open-ended search
+    {
+        Board b;
+        b.setStartPos();
+        SearchLimits limits;
+        limits.movetime = 300;
+
+        std::cout << "startpos movetime " << limits.movetime << "\n";
+        auto t0 = std::chrono::steady_clock::now();
+        SearchInfo info = search.go(b, limits, printInfo);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+
+        // small allowance for scheduling noise on loaded machines
+        if (!info.pv.empty() && ms <= limits.movetime + 50) {
+            std::cout << "[PASS] movetime (" << ms << " ms)\n";
+        } else {
+            std::cerr << "[FAIL] movetime: took " << ms << " ms\n";
+            failed++;
+        }
+    }
+
+    if (runScaling) scaling(scalingDepth);
+
+    return summary();
+}
@@ -0,0 +1,142 @@
+#include "chess/board.hpp"
+#include "chess/fen.hpp"
+#include "chess/perft.hpp"
+#include "chess/search.hpp"
+#include "chess/see.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace chess;
+
+struct SeeCase {
+    const char* name;
+    const char* fen;
+    const char* move; // UCI
+    int value;        // worked out by hand with PIECE_VALUE (P 100, N 320, B 330, R 500, Q 900)
+};
+
+static const SeeCase SEE_CASES[] = {
+    { "undefended pawn",              "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100 },
+    // NxP NxN RxN BxR QxB QxQ: black stops white after BxR, white never plays Nxe5
+    { "long exchange with x-rays",    "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -220 },
+    { "rook takes defended pawn",     "4k3/8/3p4/4p3/8/8/8/4R1K1 w - - 0 1", "e1e5", -400 },
+    { "doubled rooks, x-ray",         "4r1k1/8/8/4p3/8/8/4R3/4R1K1 w - - 0 1", "e2e5", 100 },
+    { "bishop and queen battery",     "4k3/8/5p2/4n3/8/2B5/1Q6/4K3 w - - 0 1", "c3e5", 90 },
+    { "king recaptures",              "8/8/8/3k4/4p3/8/8/4R1K1 w - - 0 1", "e1e4", -400 },
+    { "king cannot take defended",    "8/8/8/3k4/4p3/8/2B5/4R1K1 w - - 0 1", "e1e4", 100 },
+    { "pawn takes defended queen",    "4k3/8/3p4/4q3/3P4/8/8/4K3 w - - 0 1", "d4e5", 800 },
+    { "en passant",                   "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100 },
+    { "promotion capture, king takes","3rk3/2P5/8/8/8/8/8/4K3 w - - 0 1", "c7d8q", 400 },
+    { "promotion capture, free",      "3r3k/2P5/8/8/8/8/8/4K3 w - - 0 1", "c7d8q", 1300 },
+    { "quiet move into a pawn",       "4k3/8/2p5/8/8/2N5/8/4K3 w - - 0 1", "c3d5", -320 },
+    { "black, rook takes defended N", "3r2k1/8/8/3N4/8/8/8/3R2K1 b - - 0 1", "d8d5", -180 },
+};
+
+static bool findMove(const Board& b, const std::string& uci, Move& out) {
+    MoveList moves;
+    b.generateLegalMoves(moves);
+    for (const Move& m : moves) {
+        if (toUci(m) == uci) {
+            out = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+using MoveKey = std::tuple<int, int, int>;
+
+static std::vector<MoveKey> keys(const MoveList& moves) {
+    std::vector<MoveKey> k;
+    for (const Move& m : moves) k.emplace_back(m.from(), m.to(), m.flags());
+    std::sort(k.begin(), k.end());
+    return k;
+}
+
+// at every node, the captures generator must give exactly the captures and promotions
+// of the full generator, the quiets generator the rest, and the pseudo-legal generator
+// the same moves once those leaving the king in check are dropped
+static bool capturesMatch(Board& b, int depth, std::uint64_t& nodes) {
+    MoveList all, captures, quiets, pseudo, expected, legalPseudo;
+    b.generateLegalMoves(all);
+    b.generateLegalMoves(captures, GEN_CAPTURES);
+    b.generateLegalMoves(quiets, GEN_QUIETS);
+    b.generateMoves(pseudo);
+    for (const Move& m : all)
+        if (has(m.flags(), MF_Capture) || has(m.flags(), MF_PromoMask)) expected.push_back(m);
+    StateInfo test;
+    for (const Move& m : pseudo) {
+        b.makeMove(m, test);
+        if (!b.isInCheck(other(b.sideToMove))) legalPseudo.push_back(m);
+        b.unmakeMove(m);
+    }
+    nodes++;
+    if (keys(captures) != keys(expected)) {
+        std::cerr << "    captures differ in " << toFEN(b) << "\n";
+        return false;
+    }
+    for (const Move& m : quiets) captures.push_back(m);
+    if (keys(captures) != keys(all) || keys(legalPseudo) != keys(all)) {
+        std::cerr << "    quiet or pseudo-legal moves differ in " << toFEN(b) << "\n";
+        return false;
+    }
+    if (depth == 0) return true;
+    StateInfo st;
+    for (const Move& m : all) {
+        b.makeMove(m, st);
+        const bool ok = capturesMatch(b, depth - 1, nodes);
+        b.unmakeMove(m);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+int main() {
+    for (const SeeCase& c : SEE_CASES) {
+        Board b;
+        setFromFEN(b, c.fen);
+        Move m{};
+        if (!findMove(b, c.move, m)) {
+            check(false, std::string(c.name) + ": " + c.move + " not legal");
+            continue;
+        }
+        const int v = see(b, m);
+        const bool ge = seeGE(b, m, c.value) && !seeGE(b, m, c.value + 1);
+        check(v == c.value && ge, std::string(c.name) + ": see(" + c.move + ") = " + std::to_string(v)
+                                  + ", expected " + std::to_string(c.value));
+    }
+
+    const char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    };
+    for (const char* fen : fens) {
+        Board b;
+        setFromFEN(b, fen);
+        std::uint64_t nodes = 0;
+        const bool ok = capturesMatch(b, 3, nodes);
+        check(ok, "captures, quiets and pseudo-legal generators, depth 3, " + std::to_string(nodes) + " nodes: " + fen);
+    }
+
+    // the quiescence search sees the recapture a bare depth-1 search would miss
+    {
+        Board b;
+        setFromFEN(b, "4k3/8/3p4/4p3/8/8/8/4R1K1 w - - 0 1");
+        Search search;
+        SearchLimits limits;
+        limits.depth = 1;
+        const SearchInfo info = search.go(b, limits);
+        const std::string best = info.pv.empty() ? "" : toUci(info.pv[0]);
+        check(best != "e1e5", "quiescence: depth 1 does not take the defended pawn (" + best + ")");
+    }
+
+    return summary();
+}
@@ -0,0 +1,139 @@
+#include "chess/board.hpp"
+#include "chess/fen.hpp"
+#include "chess/search.hpp"
+#include "chess/tt.hpp"
+#include "check.hpp"
+
+#include <iostream>
+#include <string>
+
+using namespace chess;
+
+// keys that land in the same cluster of a 1 MiB table (16384 clusters: the top 14 bits
+// pick the cluster) and differ in the stored key bits
+static U64 sameCluster(int i) {
+    return 0x5A5A000000000000ULL | static_cast<U64>(i + 1);
+}
+
+// every legal move down to depth survives the 16 bits: rebuilt from its fields, and read
+// back from a stored entry
+static bool movesRoundTrip(const Board& b, int depth, int& moves) {
+    MoveList list;
+    b.generateLegalMoves(list);
+    for (const Move& m : list) {
+        ++moves;
+        const Move rebuilt(m.from(), m.to(), m.flags());
+        if (rebuilt != m || Move::fromRaw(packMove(m)) != m || packMove(m) == 0) return false;
+        if (depth > 1 && !movesRoundTrip(b.applied(m), depth - 1, moves)) return false;
+    }
+    return true;
+}
+
+int main() {
+    // moves are stored as they are
+    for (const char* fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+                            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"}) {
+        Board b;
+        setFromFEN(b, fen);
+        int moves = 0;
+        const bool ok = movesRoundTrip(b, 3, moves);
+        check(ok, "16-bit moves round-trip, " + std::to_string(moves) + " moves: " + fen);
+    }
+
+    // memory is exactly what was asked for
+    for (std::size_t mb : {1, 3, 7, 64}) {
+        TranspositionTable tt(mb);
+        check(tt.bytes() == mb * 1024 * 1024, "size " + std::to_string(mb) + " MiB = " + std::to_string(tt.bytes()) + " bytes");
+    }
+
+    TranspositionTable tt(1);
+
+    // round trip of every field
+    {
+        tt.store(0x123456789ABCDEF0ULL, -31990, 42, BOUND_LOWER, 0x4321);
+        TTEntry e;
+        const bool hit = tt.probe(0x123456789ABCDEF0ULL, e);
+        check(hit && e.score == -31990 && e.depth == 42 && e.bound == BOUND_LOWER
+              && e.move == 0x4321 && e.generation == tt.generation(), "store/probe round trip");
+        check(!tt.probe(0x123456789ABCDEF1ULL, e), "other key misses");
+    }
+
+    // a bound without a move keeps the move already known
+    {
+        tt.store(0x1111ULL, 10, 3, BOUND_EXACT, 0x0777);
+        tt.store(0x1111ULL, 5, 4, BOUND_UPPER, 0);
+        TTEntry e;
+        check(tt.probe(0x1111ULL, e) && e.move == 0x0777 && e.depth == 4, "move kept on moveless update");
+    }
+
+    // full cluster, same search: the shallowest entry goes
+    {
+        tt.clear();
+        for (int i = 0; i < TranspositionTable::CLUSTER_SIZE; ++i) tt.store(sameCluster(i), 0, 10 + i, BOUND_EXACT, 0);
+        tt.store(sameCluster(100), 0, 5, BOUND_EXACT, 0);
+        TTEntry e;
+        check(tt.probe(sameCluster(100), e) && !tt.probe(sameCluster(0), e)
+              && tt.probe(sameCluster(TranspositionTable::CLUSTER_SIZE - 1), e), "depth-preferred replacement");
+    }
+
+    // full cluster of deep entries from an older search: a shallow new one still gets in
+    {
+        tt.clear();
+        for (int i = 0; i < TranspositionTable::CLUSTER_SIZE; ++i) tt.store(sameCluster(i), 0, 30, BOUND_EXACT, 0);
+        tt.newSearch();
+        tt.newSearch();
+        tt.newSearch();
+        tt.newSearch();
+        tt.store(sameCluster(100), 0, 1, BOUND_EXACT, 0);
+        TTEntry e;
+        check(tt.probe(sameCluster(100), e), "aged entries are replaced");
+    }
+
+    // a full table, probed with keys never stored: hits are false ones, about
+    // CLUSTER_SIZE / 2^KEY_BITS of the probes
+    {
+        tt.clear();
+        U64 k = 0x2545F4914F6CDD1DULL;
+        auto next = [&k] { k ^= k << 13; k ^= k >> 7; k ^= k << 17; return k; };
+        for (std::size_t i = 0; i < 4 * tt.clusters() * TranspositionTable::CLUSTER_SIZE; ++i) tt.store(next(), 0, 1, BOUND_EXACT, 0);
+        const int probes = 1 << 20;
+        int hits = 0;
+        TTEntry e;
+        for (int i = 0; i < probes; ++i) hits += tt.probe(next(), e);
+        const double expected = static_cast<double>(TranspositionTable::CLUSTER_SIZE) / (1 << TranspositionTable::KEY_BITS);
+        std::cout << "    false hits " << hits << " in " << probes << " probes, expected about "
+                  << static_cast<int>(expected * probes) << "\n";
+        check(hits <= 2 * expected * probes, "false-hit rate of random keys");
+    }
+
+    // hashfull counts only entries of the current search
+    {
+        tt.clear(4);
+        check(tt.hashfull() == 0, "empty after parallel clear");
+        U64 k = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < 200000; ++i) {
+            k ^= k << 13; k ^= k >> 7; k ^= k << 17;
+            tt.store(k, 0, 1, BOUND_EXACT, 0);
+        }
+        const int full = tt.hashfull();
+        tt.newSearch();
+        std::cout << "    hashfull " << full << " then " << tt.hashfull() << " after newSearch\n";
+        check(full > 500 && full <= 1000 && tt.hashfull() == 0, "hashfull");
+    }
+
+    // a second search of the same position is cheaper with the table kept
+    {
+        Board b;
+        b.setStartPos();
+        Search search;
+        SearchLimits limits;
+        limits.depth = 5;
+        const SearchInfo cold = search.go(b, limits);
+        const SearchInfo warm = search.go(b, limits);
+        std::cout << "    depth 5: " << cold.nodes << " nodes cold, " << warm.nodes << " warm, hashfull " << warm.hashfull << "\n";
+        check(warm.nodes < cold.nodes && !warm.pv.empty(), "search reuses the table");
+    }
+
+    return summary();
+}
@@ -0,0 +1,228 @@
+#include "chess/board.hpp"
+#include "chess/fen.hpp"
+#include "chess/perft.hpp"
+#include "chess/uci.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chess;
+
+static bool contains(const std::string& s, const std::string& what) {
+    return s.find(what) != std::string::npos;
+}
+
+// last line of out starting with prefix, empty if none
+static std::string lastLine(const std::string& out, const std::string& prefix) {
+    std::istringstream lines(out);
+    std::string line, last;
+    while (std::getline(lines, line))
+        if (line.rfind(prefix, 0) == 0) last = line;
+    return last;
+}
+
+// every legal move of every node down to depth reads back from its text
+static bool uciRoundTrip(const Board& b, int depth, std::uint64_t& moves) {
+    MoveList list;
+    b.generateLegalMoves(list);
+    for (const Move& m : list) {
+        Move back{};
+        ++moves;
+        if (!fromUci(b, toUci(m), back) || back != m) {
+            std::cerr << "    " << toUci(m) << " does not read back in " << toFEN(b) << "\n";
+            return false;
+        }
+        if (depth > 1 && !uciRoundTrip(b.applied(m), depth - 1, moves)) return false;
+    }
+    return true;
+}
+
+int main() {
+    // move text, both directions
+    {
+        const char* fens[] = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        };
+        for (const char* fen : fens) {
+            Board b;
+            setFromFEN(b, fen);
+            std::uint64_t moves = 0;
+            const bool ok = uciRoundTrip(b, 3, moves);
+            check(ok, "fromUci(toUci(m)) == m, " + std::to_string(moves) + " moves: " + fen);
+        }
+        Board b;
+        setFromFEN(b, STARTPOS_FEN);
+        Move m{};
+        check(!fromUci(b, "e2e5", m) && !fromUci(b, "e7e5", m) && !fromUci(b, "e2", m)
+              && !fromUci(b, "i2i4", m) && !fromUci(b, "e2e4q", m), "illegal or malformed text is refused");
+    }
+
+    // handshake
+    {
+        std::ostringstream out;
+        Uci uci(out);
+        uci.command("uci");
+        uci.command("isready");
+        const std::string s = out.str();
+        check(contains(s, "id name ") && contains(s, "option name Hash type spin")
+              && contains(s, "option name Threads type spin") && contains(s, "option name EvalFile type string")
+              && contains(s, "\nuciok\n") && contains(s, "\nreadyok\n"), "uci lists id and options, uciok, readyok");
+    }
+
+    // position: startpos and fen, with moves (castling and promotion included)
+    {
+        std::ostringstream out;
+        Uci uci(out);
+        uci.command("position startpos moves e2e4 e7e5 g1f3 b8c6 f1c4 g8f6 e1g1");
+        check(toFEN(uci.position()) == "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQ1RK1 b kq - 5 4",
+              "position startpos moves ...: " + toFEN(uci.position()));
+        uci.command("position fen 8/P6k/8/8/8/8/8/K7 w - - 0 1 moves a7a8n h7g6");
+        check(toFEN(uci.position()) == "N7/8/6k1/8/8/8/8/K7 w - - 1 2", "position fen ... moves with a promotion");
+        uci.command("position startpos moves e2e4 e2e4 d2d4");
+        check(toFEN(uci.position()) == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"
+              && contains(out.str(), "illegal move e2e4"), "an illegal move stops the list, with an info string");
+        uci.command("position fen 8/8/8/8/8/8/8/K6k w KQx - 0 1");
+        check(toFEN(uci.position()) == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"
+              && contains(out.str(), "invalid fen (bad castling field at character 23)"),
+              "an invalid fen keeps the position, the info string says why and where");
+        uci.command("position fen 8/8/8/8/8/8/8/8 w - - 0 1");
+        uci.command("position fen k7/8/8/8/8/8/8/R6K w - - 0 1");
+        check(toFEN(uci.position()) == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"
+              && contains(out.str(), "not playable (a king missing or the side not to move in check): 8/8/8/8/8/8/8/8 w")
+              && contains(out.str(), "not playable (a king missing or the side not to move in check): k7/8/8/8/8/8/8/R6K w"),
+              "no king, or the side not to move in check: the position is kept");
+        uci.command("go depth 2");
+        uci.wait();
+        check(contains(out.str(), "bestmove "), "go after a refused position searches the position kept");
+    }
+
+    // go depth: info lines carry depth, score, nodes, nps, hashfull and pv; bestmove is legal
+    {
+        std::ostringstream out;
+        Uci uci(out);
+        uci.command("position startpos moves d2d4");
+        uci.command("go depth 6");
+        uci.wait();
+        const std::string s = out.str();
+        const std::string info = lastLine(s, "info depth 6 ");
+        check(contains(info, " score cp ") && contains(info, " nodes ") && contains(info, " nps ")
+              && contains(info, " hashfull ") && contains(info, " time ") && contains(info, " pv "),
+              "info line: " + info);
+        const std::string best = lastLine(s, "bestmove ");
+        std::istringstream words(best);
+        std::string word, move;
+        words >> word >> move;
+        Move m{};
+        check(fromUci(uci.position(), move, m), "legal " + best);
+    }
+
+    // a mate is given in moves
+    {
+        std::ostringstream out;
+        Uci uci(out);
+        uci.command("position fen 6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1");
+        uci.command("go depth 3");
+        uci.wait();
+        check(contains(out.str(), " score mate 1 ") && contains(out.str(), "bestmove d1d8"), "mate score: mate 1, d1d8");
+    }
+
+    // no legal move
+    {
+        std::ostringstream out;
+        Uci uci(out);
+        uci.command("position fen rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3");
+        uci.command("go depth 3");
+        uci.wait();
+        check(contains(out.str(), "bestmove 0000"), "checkmated: bestmove 0000");
+    }
+
+    // go infinite answers isready while searching, and sends bestmove only once stopped;
+    // stop returns (search stopped, bestmove sent) within a millisecond. The machine may be
+    // shared, so the fastest of five counts.
+    {
+        std::int64_t bestUs = INT64_MAX;
+        bool ordered = true;
+        for (int run = 0; run < 5; ++run) {
+            std::ostringstream out;
+            Uci uci(out);
+            uci.command("position startpos");
+            uci.command("go infinite");
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            uci.command("isready");
+            const auto start = std::chrono::steady_clock::now();
+            uci.command("stop");
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            bestUs = std::min<std::int64_t>(bestUs, us);
+            const std::string s = out.str();
+            const auto ready = s.find("readyok");
+            const auto best = s.find("bestmove ");
+            ordered = ordered && ready != std::string::npos && best != std::string::npos && ready < best;
+        }
+        check(ordered, "go infinite: readyok while searching, bestmove after stop");
+        check(bestUs < 1000, "stop answered in " + std::to_string(bestUs) + " us");
+    }
+
+    // go ponder: no bestmove before ponderhit, then the movetime runs from the ponderhit
+    {
+        std::ostringstream out;
+        Uci uci(out);
+        uci.command("position startpos moves e2e4");
+        uci.command("go ponder movetime 100");
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        uci.command("isready"); // a bestmove sent while pondering would come before this
+        const auto start = std::chrono::steady_clock::now();
+        uci.command("ponderhit");
+        uci.wait();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        const std::string s = out.str();
+        const auto ready = s.find("readyok");
+        const auto best = s.find("bestmove ");
+        check(ready != std::string::npos && best != std::string::npos && ready < best,
+              "go ponder: bestmove only after ponderhit");
+        check(ms >= 50 && ms < 1000, "ponderhit starts the 100 ms movetime (" + std::to_string(ms) + " ms)");
+    }
+
+    // options
+    {
+        std::ostringstream out;
+        Uci uci(out);
+        uci.command("setoption name Hash value 3");
+        uci.command("setoption name Threads value 2");
+        uci.command("setoption name Clear Hash");
+        uci.command("setoption name LMR value false");
+        uci.command("setoption name EvalFile value /nonexistent.nnue");
+        uci.command("setoption name NoSuchOption value 1");
+        uci.command("position startpos");
+        uci.command("go depth 4");
+        uci.wait();
+        const std::string s = out.str();
+        check(contains(s, "info string cannot open /nonexistent.nnue") && contains(s, "unknown option: NoSuchOption")
+              && contains(s, "bestmove "), "setoption Hash/Threads/Clear Hash/LMR/EvalFile, then a search");
+    }
+
+    // a whole session through the loop, quit included
+    {
+        std::istringstream in("uci\nisready\nucinewgame\nposition startpos moves e2e4\ngo depth 3\nquit\ngo depth 3\n");
+        std::ostringstream out;
+        Uci uci(out);
+        uci.loop(in);
+        const std::string s = out.str();
+        const auto first = s.find("bestmove");
+        check(first != std::string::npos && s.find("bestmove", first + 1) == std::string::npos,
+              "loop: one search, nothing after quit");
+    }
+
+    return summary();
+}